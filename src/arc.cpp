@@ -0,0 +1,160 @@
+/**
+ * Created by agent on 18.10.2026.
+ * agent@local
+ *
+ * Author: agent
+ */
+#include "arc.h"
+
+namespace mlang {
+
+    void ReferenceCounting::run() {
+        bool borrowArguments = !storesGlobalVariables();
+        for (auto &item : variables) {
+            std::vector<llvm::AllocaInst *> released;
+            for (auto variable : item.second) {
+                if (isStatic(variable) || (borrowArguments && borrowArgument(variable))) {
+                    continue;
+                }
+                released.push_back(variable);
+            }
+            runOnFunction(*item.first, released);
+        }
+
+        for (auto &function : module) {
+            if (!function.isDeclaration()) {
+                elidePairs(function);
+            }
+        }
+    }
+
+    void ReferenceCounting::runOnFunction(llvm::Function &function, std::vector<llvm::AllocaInst *> &released) {
+        std::vector<llvm::ReturnInst *> returns;
+        for (auto &block : function) {
+            if (auto ret = llvm::dyn_cast_or_null<llvm::ReturnInst>(block.getTerminator())) {
+                returns.push_back(ret);
+            }
+        }
+
+        for (auto ret : returns) {
+            releaseOnReturn(ret, released);
+        }
+    }
+
+    bool ReferenceCounting::isStatic(llvm::AllocaInst *variable) {
+        for (auto user : variable->users()) {
+            auto store = llvm::dyn_cast<llvm::StoreInst>(user);
+            if (store != nullptr && !llvm::isa<llvm::Constant>(store->getValueOperand())) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool ReferenceCounting::borrowArgument(llvm::AllocaInst *variable) {
+        // only variable initialized by argument in entry block and never assigned again (not even by constant,
+        // assignment releases old value, which belongs to caller)
+        llvm::Argument *argument = nullptr;
+        for (auto user : variable->users()) {
+            auto store = llvm::dyn_cast<llvm::StoreInst>(user);
+            if (store == nullptr) {
+                continue;
+            }
+            if (argument != nullptr || store->getParent() != &store->getFunction()->getEntryBlock()) {
+                return false;
+            }
+            argument = llvm::dyn_cast<llvm::Argument>(store->getValueOperand());
+            if (argument == nullptr) {
+                return false;
+            }
+        }
+        if (argument == nullptr) {
+            return false;
+        }
+
+        std::vector<llvm::Instruction *> retains;
+        for (auto &inst : argument->getParent()->getEntryBlock()) {
+            if (arcOperand(&inst, "__mlang_retain") == argument) {
+                retains.push_back(&inst);
+            }
+        }
+        for (auto retain : retains) {
+            retain->eraseFromParent();
+        }
+        return true;
+    }
+
+    bool ReferenceCounting::storesGlobalVariables() {
+        for (auto &global : module.globals()) {
+            if (!global.getValueType()->isPointerTy()) {
+                continue;
+            }
+            for (auto user : global.users()) {
+                auto store = llvm::dyn_cast<llvm::StoreInst>(user);
+                if (store != nullptr && store->getFunction() != initFunction) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    void ReferenceCounting::releaseOnReturn(llvm::ReturnInst *ret, std::vector<llvm::AllocaInst *> &released) {
+        llvm::IRBuilder<> builder(ret);
+        // returned value keeps its reference while variables are released, then it is passed to caller without it
+        llvm::Value *value = ret->getReturnValue();
+        bool keep = value != nullptr && value->getType()->isPointerTy() && !llvm::isa<llvm::Constant>(value);
+
+        if (keep) {
+            createArcCall(builder, "__mlang_retain", value);
+        }
+        for (auto variable : released) {
+            createArcCall(builder, "__mlang_release", builder.CreateLoad(variable->getAllocatedType(), variable));
+        }
+        if (keep) {
+            createArcCall(builder, "__mlang_unretain", value);
+        }
+    }
+
+    void ReferenceCounting::elidePairs(llvm::Function &function) {
+        std::vector<std::pair<llvm::Instruction *, llvm::Instruction *>> pairs;
+        for (auto &block : function) {
+            for (auto &inst : block) {
+                auto retained = arcOperand(&inst, "__mlang_retain");
+                if (retained == nullptr) {
+                    continue;
+                }
+                for (auto next = inst.getNextNode(); next != nullptr; next = next->getNextNode()) {
+                    if (arcOperand(next, "__mlang_unretain") == retained) {
+                        pairs.emplace_back(&inst, next);
+                        break;
+                    }
+                    // any other call can release the value
+                    if (llvm::isa<llvm::CallInst>(next)) {
+                        break;
+                    }
+                }
+            }
+        }
+
+        for (auto &pair : pairs) {
+            pair.first->eraseFromParent();
+            pair.second->eraseFromParent();
+        }
+    }
+
+    llvm::Value *ReferenceCounting::arcOperand(llvm::Instruction *inst, llvm::StringRef name) {
+        auto call = llvm::dyn_cast<llvm::CallInst>(inst);
+        if (call == nullptr || call->getCalledFunction() == nullptr || call->getCalledFunction()->getName() != name) {
+            return nullptr;
+        }
+        return call->getArgOperand(0)->stripPointerCasts();
+    }
+
+    void ReferenceCounting::createArcCall(llvm::IRBuilder<> &builder, llvm::StringRef name, llvm::Value *value) {
+        auto ptrType = builder.getInt8PtrTy();
+        auto fun = module.getOrInsertFunction(name, builder.getVoidTy(), ptrType);
+        builder.CreateCall(fun, builder.CreatePointerCast(value, ptrType));
+    }
+
+}
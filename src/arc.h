@@ -0,0 +1,84 @@
+/**
+ * Created by agent on 18.10.2026.
+ * agent@local
+ *
+ * Author: agent
+ */
+#ifndef MLANG_ARC_H
+#define MLANG_ARC_H
+
+#include <map>
+#include <vector>
+
+#pragma warning(push, 0)
+
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/IRBuilder.h>
+
+#pragma warning(pop)
+
+namespace mlang {
+
+    /**
+     * Variables holding arrays or strings in each function (--arc)
+     */
+    using ArcVariables = std::map<llvm::Function *, std::vector<llvm::AllocaInst *>>;
+
+    /**
+     * Automatic reference counting of arrays and strings (--arc)
+     * variables are released when function returns, redundant retain/release pairs are removed
+     */
+    class ReferenceCounting {
+    public:
+        ReferenceCounting(llvm::Module &module, ArcVariables &variables, llvm::Function *initFunction)
+                : module(module), variables(variables), initFunction(initFunction) {}
+
+        /**
+         * Insert releases and remove redundant reference counting in all functions
+         */
+        void run();
+
+    private:
+        void runOnFunction(llvm::Function &function, std::vector<llvm::AllocaInst *> &functionVariables);
+
+        /**
+         * Check if only constants (null, string literals) are stored to variable, so it holds no reference
+         */
+        static bool isStatic(llvm::AllocaInst *variable);
+
+        /**
+         * Argument variable which is only stored in entry block and never reassigned borrows reference of caller,
+         * its retain is removed
+         * @return true if variable is borrowed and must not be released
+         */
+        bool borrowArgument(llvm::AllocaInst *variable);
+
+        /**
+         * Check if global array or string variable is assigned outside of global code,
+         * so argument could lose its value during call
+         */
+        bool storesGlobalVariables();
+
+        void releaseOnReturn(llvm::ReturnInst *ret, std::vector<llvm::AllocaInst *> &released);
+
+        /**
+         * Remove retain directly followed by unretain of same value
+         */
+        static void elidePairs(llvm::Function &function);
+
+        /**
+         * Get pointer passed to reference counting function, nullptr if instruction is not its call
+         */
+        static llvm::Value *arcOperand(llvm::Instruction *inst, llvm::StringRef name);
+
+        void createArcCall(llvm::IRBuilder<> &builder, llvm::StringRef name, llvm::Value *value);
+
+        llvm::Module &module;
+        ArcVariables &variables;
+        llvm::Function *initFunction;
+    };
+
+}
+
+#endif /* MLANG_ARC_H */
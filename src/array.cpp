@@ -6,6 +6,7 @@
  */
 #include "array.h"
 #include "codegen.h"
+#include "parser.hpp"
 
 namespace mlang {
 
@@ -21,7 +22,7 @@ namespace mlang {
         }
 
         auto intSize = llvm::ConstantExpr::getSizeOf(llvm::Type::getInt64Ty(context.getGlobalContext()));
-        auto array = context.createMallocCall(type, count, "array", intSize);
+        auto array = context.createMallocCall(type, count, "array", intSize, &location);
 
         llvm::Value *indices[1] = {llvm::ConstantInt::get(llvm::Type::getInt64Ty(context.getGlobalContext()), 1)};
         llvm::Value *elementPtr = llvm::GetElementPtrInst::Create(nullptr, array, indices, "elem_ptr",
@@ -76,7 +77,7 @@ namespace mlang {
             return nullptr;
         }
 
-        if (var == nullptr || !var->getType()->isPointerTy()) {
+        if (var == nullptr || (!var->getType()->isPointerTy() && !context.isSliceType(var->getType()))) {
             Identifier *ident = expr->getType() == NodeType::IDENTIFIER ? (Identifier *) expr : nullptr;
             if (ident != nullptr) {
                 Node::printError(location, "variable '" + ident->getName() + "' is not array");
@@ -88,6 +89,7 @@ namespace mlang {
         }
 
         Array::validateArrayBounds(var, indexValue, context);
+        var = context.getArrayPointer(var);
 
         llvm::Value *indices[1] = {indexValue};
         llvm::Value *elementPtr = llvm::GetElementPtrInst::Create(nullptr, var, indices, "elem_ptr",
@@ -107,7 +109,7 @@ namespace mlang {
             return nullptr;
         }
 
-        if (var == nullptr || !var->getType()->isPointerTy()) {
+        if (var == nullptr || (!var->getType()->isPointerTy() && !context.isSliceType(var->getType()))) {
             Identifier *ident = lhs->getType() == NodeType::IDENTIFIER ? (Identifier *) lhs : nullptr;
             if (ident != nullptr) {
                 Node::printError(location, "variable '" + ident->getName() + "' is not array");
@@ -118,13 +120,15 @@ namespace mlang {
             return nullptr;
         }
 
-        if (value == nullptr || value->getType() != var->getType()->getPointerElementType()) {
+        llvm::Value *arrayPtr = context.getArrayPointer(var);
+        if (value == nullptr || value->getType() != arrayPtr->getType()->getPointerElementType()) {
             Node::printError(location, "Invalid assignment to array");
             context.addError();
             return nullptr;
         }
 
         Array::validateArrayBounds(var, indexValue, context);
+        var = arrayPtr;
 
         llvm::Value *indices[1] = {indexValue};
         llvm::Value *elementPtr = llvm::GetElementPtrInst::Create(nullptr, var, indices, "elem_ptr",
@@ -133,4 +137,231 @@ namespace mlang {
         new llvm::StoreInst(value, elementPtr, false, context.currentBlock());
         return value;
     }
+
+    llvm::Value *ArraySlice::codeGen(CodeGenContext &context) {
+        llvm::Value *array = expr->codeGen(context);
+        if (array == nullptr) {
+            return nullptr;
+        }
+
+        llvm::Value *from = range->getLhs()->codeGen(context);
+        llvm::Value *to = range->getRhs()->codeGen(context);
+        return createSlice(context, array, from, to, range->getOp() == TTO, location);
+    }
+
+    llvm::Value *ArraySlice::createSlice(CodeGenContext &context, llvm::Value *array, llvm::Value *from, llvm::Value *to,
+                                        bool inclusive, const YYLTYPE &location) {
+        auto intType = llvm::Type::getInt64Ty(context.getGlobalContext());
+
+        if (!context.isSliceType(array->getType()) && context.getSliceType(array->getType()) == nullptr) {
+            Node::printError(location, "Only arrays and strings can be sliced");
+            context.addError();
+            return nullptr;
+        }
+
+        if (from == nullptr || to == nullptr || from->getType() != intType || to->getType() != intType) {
+            Node::printError(location, "Invalid slice bounds");
+            context.addError();
+            return nullptr;
+        }
+
+        if (inclusive) {
+            to = llvm::BinaryOperator::Create(llvm::Instruction::Add, to, llvm::ConstantInt::get(intType, 1), "to",
+                                              context.currentBlock());
+        }
+
+        llvm::Value *size = context.callSizeOf(array);
+        validateSliceBounds(from, to, size, context);
+
+        llvm::Value *indices[1] = {from};
+        llvm::Value *ptr = llvm::GetElementPtrInst::Create(nullptr, context.getArrayPointer(array), indices,
+                                                           "slice_ptr", context.currentBlock());
+        auto sliceSize = llvm::BinaryOperator::Create(llvm::Instruction::Sub, to, from, "slice_size",
+                                                      context.currentBlock());
+        return context.createSlice(ptr, sliceSize);
+    }
+
+    void ArraySlice::validateSliceBounds(llvm::Value *from, llvm::Value *to, llvm::Value *size,
+                                         CodeGenContext &context) {
+        llvm::Function *function = context.currentBlock()->getParent();
+        llvm::BasicBlock *errBlock = llvm::BasicBlock::Create(context.getGlobalContext(), "slice_err");
+        llvm::BasicBlock *successBlock = llvm::BasicBlock::Create(context.getGlobalContext(), "slice_success");
+
+        // 0 <= from <= to <= size
+        auto zeroVal = llvm::ConstantInt::get(llvm::Type::getInt64Ty(context.getGlobalContext()), 0);
+        llvm::Value *valid = llvm::CmpInst::Create(llvm::Instruction::ICmp, llvm::CmpInst::ICMP_SGE, from, zeroVal,
+                                                   "cmptmp", context.currentBlock());
+        auto cmp = llvm::CmpInst::Create(llvm::Instruction::ICmp, llvm::CmpInst::ICMP_SLE, from, to, "cmptmp",
+                                         context.currentBlock());
+        valid = llvm::BinaryOperator::Create(llvm::Instruction::And, valid, cmp, "valid", context.currentBlock());
+        cmp = llvm::CmpInst::Create(llvm::Instruction::ICmp, llvm::CmpInst::ICMP_SLE, to, size, "cmptmp",
+                                    context.currentBlock());
+        valid = llvm::BinaryOperator::Create(llvm::Instruction::And, valid, cmp, "valid", context.currentBlock());
+        llvm::BranchInst::Create(successBlock, errBlock, valid, context.currentBlock());
+
+        function->getBasicBlockList().push_back(errBlock);
+        context.newScope(errBlock, ScopeType::CODE_BLOCK);
+
+        context.runtimeError(RuntimeError::INDEX_OUT_OF_RANGE);
+        llvm::BranchInst::Create(successBlock, context.currentBlock());
+
+        function->getBasicBlockList().push_back(successBlock);
+        context.endScope();
+
+        context.newScope(successBlock, ScopeType::CODE_BLOCK);
+        context.endScope();
+        context.setInsertPoint(successBlock);
+    }
+
+    llvm::Value *DynamicArray::codeGen(CodeGenContext &context) {
+        size_t argsCount = operation == Operation::PUSH || operation == Operation::RESERVE ? 2 : 1;
+        if (args->size() != argsCount) {
+            Node::printError(location, "Invalid number of arguments");
+            context.addError();
+            return nullptr;
+        }
+
+        llvm::Value *array = args->at(0)->codeGen(context);
+        if (array == nullptr || !array->getType()->isPointerTy() ||
+            array->getType() == llvm::Type::getInt8PtrTy(context.getGlobalContext())) {
+            Node::printError(location, "Only IntArray, DoubleArray and BoolArray can be resized");
+            context.addError();
+            return nullptr;
+        }
+
+        auto itemType = array->getType()->getPointerElementType();
+        auto intType = llvm::Type::getInt64Ty(context.getGlobalContext());
+
+        switch (operation) {
+            case Operation::PUSH: {
+                llvm::Value *value = args->at(1)->codeGen(context);
+                if (value == nullptr || value->getType() != itemType) {
+                    Node::printError(location, "Invalid value pushed to array");
+                    context.addError();
+                    return nullptr;
+                }
+
+                array = resize(context, array, "__mlang_push", nullptr);
+                if (array == nullptr) {
+                    return nullptr;
+                }
+
+                auto size = new llvm::LoadInst(intType, sizePointer(context, array), "size", context.currentBlock());
+                auto last = llvm::BinaryOperator::Create(llvm::Instruction::Sub, size, llvm::ConstantInt::get(intType, 1),
+                                                         "last", context.currentBlock());
+                llvm::Value *indices[1] = {last};
+                llvm::Value *elementPtr = llvm::GetElementPtrInst::Create(nullptr, array, indices, "elem_ptr",
+                                                                          context.currentBlock());
+                new llvm::StoreInst(value, elementPtr, false, context.currentBlock());
+                return value;
+            }
+            case Operation::POP: {
+                auto sizePtr = sizePointer(context, array);
+                auto size = new llvm::LoadInst(intType, sizePtr, "size", context.currentBlock());
+                auto last = llvm::BinaryOperator::Create(llvm::Instruction::Sub, size, llvm::ConstantInt::get(intType, 1),
+                                                         "last", context.currentBlock());
+                Array::validateArrayBounds(array, last, context);
+
+                llvm::Value *indices[1] = {last};
+                llvm::Value *elementPtr = llvm::GetElementPtrInst::Create(nullptr, array, indices, "elem_ptr",
+                                                                          context.currentBlock());
+                auto item = new llvm::LoadInst(itemType, elementPtr, "item", context.currentBlock());
+                new llvm::StoreInst(last, sizePtr, false, context.currentBlock());
+                return item;
+            }
+            case Operation::RESERVE: {
+                llvm::Value *count = args->at(1)->codeGen(context);
+                if (count == nullptr || count->getType() != intType) {
+                    Node::printError(location, "Invalid array capacity");
+                    context.addError();
+                    return nullptr;
+                }
+                return resize(context, array, "__mlang_reserve", count);
+            }
+            case Operation::CLEAR: {
+                // capacity is kept, so array can be filled again without allocation
+                new llvm::StoreInst(llvm::ConstantInt::get(intType, 0), sizePointer(context, array), false,
+                                    context.currentBlock());
+                return array;
+            }
+        }
+
+        return nullptr;
+    }
+
+    llvm::Value *DynamicArray::resize(CodeGenContext &context, llvm::Value *array, const std::string &function,
+                                      llvm::Value *count) {
+        Identifier *ident = args->at(0)->getType() == NodeType::IDENTIFIER ? (Identifier *) args->at(0) : nullptr;
+        if (ident == nullptr) {
+            Node::printError(location, "Array can be resized only in variable");
+            context.addError();
+            return nullptr;
+        }
+        Variable *var = context.findVariable(ident->getName(), false);
+
+        // moved array would be freed under caller's variable
+        for (auto user : var->getValue()->users()) {
+            auto store = llvm::dyn_cast<llvm::StoreInst>(user);
+            if (store != nullptr && llvm::isa<llvm::Argument>(store->getValueOperand())) {
+                Node::printError(location, "Array argument of function cannot be resized");
+                context.addError();
+                return nullptr;
+            }
+        }
+
+        // other variable would keep moved array, with --arc it is checked at runtime by reference count
+        if (!context.isArc() && isShared(var->getValue())) {
+            Node::printError(location, "Array assigned to more variables cannot be resized");
+            context.addError();
+            return nullptr;
+        }
+
+        auto ptrType = llvm::Type::getInt8PtrTy(context.getGlobalContext());
+        auto intType = llvm::Type::getInt64Ty(context.getGlobalContext());
+        auto itemSize = llvm::ConstantExpr::getSizeOf(array->getType()->getPointerElementType());
+
+        llvm::FunctionCallee fun;
+        std::vector<llvm::Value *> fargs;
+        fargs.push_back(llvm::CastInst::CreatePointerCast(array, ptrType, "cast_tmp", context.currentBlock()));
+        fargs.push_back(itemSize);
+        if (count != nullptr) {
+            fun = context.getModule()->getOrInsertFunction(function, ptrType, ptrType, intType, intType);
+            fargs.push_back(count);
+        } else {
+            fun = context.getModule()->getOrInsertFunction(function, ptrType, ptrType, intType);
+        }
+
+        // array can be moved, variable gets new array (reference count is moved with it)
+        auto moved = llvm::CallInst::Create(fun, fargs, "moved", context.currentBlock());
+        auto result = new llvm::BitCastInst(moved, array->getType(), "array", context.currentBlock());
+        new llvm::StoreInst(result, var->getValue(), false, context.currentBlock());
+        return result;
+    }
+
+    llvm::Value *DynamicArray::sizePointer(CodeGenContext &context, llvm::Value *array) {
+        auto intType = llvm::Type::getInt64Ty(context.getGlobalContext());
+        auto header = new llvm::BitCastInst(array, intType->getPointerTo(), "header", context.currentBlock());
+        llvm::Value *indices[1] = {llvm::ConstantInt::get(intType, -1)};
+        return llvm::GetElementPtrInst::Create(intType, header, indices, "size_ptr", context.currentBlock());
+    }
+
+    bool DynamicArray::isShared(llvm::Value *variable) {
+        for (auto user : variable->users()) {
+            if (auto store = llvm::dyn_cast<llvm::StoreInst>(user)) {
+                auto load = llvm::dyn_cast<llvm::LoadInst>(store->getValueOperand());
+                if (load != nullptr && load->getPointerOperand() != variable) {
+                    return true;
+                }
+            } else if (auto load = llvm::dyn_cast<llvm::LoadInst>(user)) {
+                for (auto loadUser : load->users()) {
+                    auto copy = llvm::dyn_cast<llvm::StoreInst>(loadUser);
+                    if (copy != nullptr && copy->getValueOperand() == load && copy->getPointerOperand() != variable) {
+                        return true;
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
 }
\ No newline at end of file
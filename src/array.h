@@ -8,6 +8,7 @@
 #define MLANG_ARRAY_H
 
 #include "ast.h"
+#include "range.h"
 
 namespace mlang {
 
@@ -103,6 +104,83 @@ namespace mlang {
         YYLTYPE location;
     };
 
+    /**
+     * Array slice (view to part of array or string, items are not copied)
+     * arr[from until to], arr[from to to]
+     */
+    class ArraySlice : public Expression {
+    public:
+        ArraySlice(Expression *expr, Range *range, YYLTYPE location)
+                : expr(expr), range(range), location(std::move(location)) {}
+
+        ~ArraySlice() override {
+            delete expr;
+            delete range;
+        }
+
+        llvm::Value *codeGen(CodeGenContext &context) override;
+
+        NodeType getType() override { return NodeType::EXPRESSION; }
+
+        std::string toString() override { return "Array slice"; }
+
+        /**
+         * Create slice of array, string or other slice
+         * @param inclusive true if item at index to is part of slice
+         */
+        static llvm::Value *createSlice(CodeGenContext &context, llvm::Value *array, llvm::Value *from, llvm::Value *to,
+                                        bool inclusive, const YYLTYPE &location);
+
+    private:
+        static void validateSliceBounds(llvm::Value *from, llvm::Value *to, llvm::Value *size,
+                                        CodeGenContext &context);
+
+        Expression *expr{nullptr};
+        Range *range{nullptr};
+        YYLTYPE location;
+    };
+
+    /**
+     * Growable array functions
+     * push(arr, value), pop(arr), reserve(arr, count), clear(arr)
+     */
+    class DynamicArray : public Expression {
+    public:
+        enum class Operation {
+            PUSH, POP, RESERVE, CLEAR
+        };
+
+        DynamicArray(Operation operation, ExpressionList *args, YYLTYPE location)
+                : operation(operation), args(args), location(std::move(location)) {}
+
+        llvm::Value *codeGen(CodeGenContext &context) override;
+
+        NodeType getType() override { return NodeType::EXPRESSION; }
+
+        std::string toString() override { return "Dynamic array"; }
+
+    private:
+        /**
+         * Call runtime function which can move array and store new array to variable
+         */
+        llvm::Value *resize(CodeGenContext &context, llvm::Value *array, const std::string &function,
+                            llvm::Value *count);
+
+        /**
+         * Get pointer to array size header
+         */
+        static llvm::Value *sizePointer(CodeGenContext &context, llvm::Value *array);
+
+        /**
+         * Check if array of variable was assigned to other variable (b = a) or from other variable (a = b)
+         */
+        static bool isShared(llvm::Value *variable);
+
+        Operation operation;
+        ExpressionList *args;
+        YYLTYPE location;
+    };
+
 }
 
 #endif /* MLANG_ARRAY_H */
@@ -30,6 +30,13 @@ namespace mlang {
             return nullptr;
         }
 
+        // slice points into its array, which is not kept alive by reference counting
+        if (context.isArc() && context.isSliceType(value->getType())) {
+            Node::printError(location, " Slice cannot be stored to variable with --arc");
+            context.addError();
+            return nullptr;
+        }
+
         if (!context.hasVariable(ident->getName())) {
             Node::printError(location, " Assignment to undefined variable '" + ident->getName() + "'");
             context.addError();
@@ -50,7 +57,7 @@ namespace mlang {
                                                   llvm::GlobalValue::PrivateLinkage,
                                                   llvm::Constant::getNullValue(ty), ident->getName());
                     gv->setAlignment(llvm::MaybeAlign(4));
-                    new llvm::StoreInst(value, gv, false, context.currentBlock());
+                    context.createArcStore(value, gv);
                 } else {
                     gv = new llvm::GlobalVariable(*context.getModule(), ty, var->isConst(),
                                                   llvm::GlobalValue::PrivateLinkage,
@@ -59,6 +66,9 @@ namespace mlang {
                 }
                 var->setValue(gv);
                 return gv;
+            } else if (context.isArc() && ty->isPointerTy()) {
+                var->setValue(context.createArcVariable(ty, ident->getName()));
+                varType = var->getType();
             } else {
                 auto lv = new llvm::AllocaInst(ty, 0, ident->getName(), context.currentBlock());
                 var->setValue(lv);
@@ -85,7 +95,7 @@ namespace mlang {
             return nullptr;
         }
 
-        new llvm::StoreInst(value, var->getValue(), false, context.currentBlock());
+        context.createArcStore(value, var->getValue());
         return value;
     }
 
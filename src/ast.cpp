@@ -47,6 +47,10 @@ namespace mlang {
             if (mlang::CodeGenContext::isBreakingInstruction(last)) {
                 break;
             }
+            // result of expression statement is not used (except last one, which can be result of block)
+            if (s->getType() == NodeType::EXPRESSION && s != statements.back()) {
+                context.createArcCall("__mlang_drop", last);
+            }
         }
         return last;
     }
@@ -43,6 +43,7 @@ namespace mlang {
         EXPRESSION,
         VARIABLE,
         FUNCTION,
+        FUNCTION_CALL,
         INTEGER,
         DOUBLE,
         BOOLEAN,
@@ -8,8 +8,26 @@
 #include <string>
 #include <cstdarg>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <vector>
+#include <map>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <charconv>
+#include <cctype>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <termios.h>
+#endif
 
 extern "C" DECLSPEC void print(char *str, ...) {
     va_list argp;
@@ -25,68 +43,488 @@ extern "C" DECLSPEC void println(char *str, ...) {
             va_end(argp);
 }
 
+/**
+ * Output of print and println
+ * output is collected in large per-thread buffer and written to stdout by flush policy (line, full or size),
+ * when buffer is full, buffered and new data are written together by one writev call
+ */
+namespace {
+    constexpr int64_t OUTPUT_BUFFER_SIZE = 256 * 1024;
+
+#ifdef _WIN32
+    using Descriptor = HANDLE;
+#else
+    using Descriptor = int;
+#endif
+
+    struct OutputBuffer {
+        Descriptor descriptor{};
+        char *data{nullptr};
+        int64_t used{0};
+        int64_t capacity{0};
+        FlushMode mode{FlushMode::FULL};
+    };
+
+    std::atomic<int64_t> flushMode{(int64_t) FlushMode::AUTO};
+    std::atomic<int64_t> flushSize{OUTPUT_BUFFER_SIZE};
+    thread_local OutputBuffer output; // trivially destructible, so it can be flushed by atexit
+
+    // unistd.h is not included, its read() conflicts with build-in read()
+    void writeOutput(Descriptor descriptor, const char *data, int64_t size) {
+        while (size > 0) {
+#ifdef _WIN32
+            DWORD written = 0;
+            if (!WriteFile(descriptor, data, (DWORD) std::min<int64_t>(size, INT32_MAX), &written, nullptr) ||
+                written == 0) {
+                return;
+            }
+#else
+            iovec part{(void *) data, (size_t) size};
+            ssize_t written = writev(descriptor, &part, 1);
+            if (written <= 0) {
+                return;
+            }
+#endif
+            data += written;
+            size -= written;
+        }
+    }
+
+    void writeOutput(Descriptor descriptor, const char *first, int64_t firstSize, const char *second,
+                     int64_t secondSize) {
+#ifdef _WIN32
+        writeOutput(descriptor, first, firstSize);
+        writeOutput(descriptor, second, secondSize);
+#else
+        iovec parts[2] = {{(void *) first, (size_t) firstSize}, {(void *) second, (size_t) secondSize}};
+        ssize_t written = writev(descriptor, parts, 2);
+        if (written < 0) {
+            return;
+        }
+        // rest of partial write
+        if (written < firstSize) {
+            writeOutput(descriptor, first + written, firstSize - written);
+            writeOutput(descriptor, second, secondSize);
+        } else {
+            writeOutput(descriptor, second + (written - firstSize), secondSize - (written - firstSize));
+        }
+#endif
+    }
+
+    bool isTerminal(Descriptor descriptor) {
+#ifdef _WIN32
+        return GetFileType(descriptor) == FILE_TYPE_CHAR;
+#else
+        termios attributes{};
+        return tcgetattr(descriptor, &attributes) == 0;
+#endif
+    }
+
+    void flushBuffer(OutputBuffer &buffer) {
+        if (buffer.used > 0) {
+            writeOutput(buffer.descriptor, buffer.data, buffer.used);
+            buffer.used = 0;
+        }
+    }
+
+    void flushOutput() {
+        flushBuffer(output);
+    }
+
+    void initOutput() {
+#ifdef _WIN32
+        output.descriptor = GetStdHandle(STD_OUTPUT_HANDLE);
+#else
+        output.descriptor = 1;
+#endif
+        auto mode = (FlushMode) flushMode.load(std::memory_order_relaxed);
+        if (mode == FlushMode::AUTO) {
+            // terminal shows every line immediately, pipe and file get full buffers
+            mode = isTerminal(output.descriptor) ? FlushMode::LINE : FlushMode::FULL;
+        }
+        output.mode = mode;
+        output.capacity = std::max(OUTPUT_BUFFER_SIZE, flushSize.load(std::memory_order_relaxed));
+        output.data = (char *) malloc(output.capacity);
+        if (output.data == nullptr) {
+            output.capacity = 0;
+        }
+
+        // text already written by stdio must be before program output
+        fflush(stdout);
+        static std::once_flag exitFlush;
+        std::call_once(exitFlush, []() { atexit(flushOutput); });
+    }
+
+    void bufferWrite(OutputBuffer &buffer, const char *str, int64_t size) {
+        if (buffer.used + size > buffer.capacity) {
+            writeOutput(buffer.descriptor, buffer.data, buffer.used, str, size);
+            buffer.used = 0;
+            return;
+        }
+
+        memcpy(buffer.data + buffer.used, str, size);
+        buffer.used += size;
+
+        if ((buffer.mode == FlushMode::LINE && memchr(str, '\n', size) != nullptr) ||
+            (buffer.mode == FlushMode::SIZE && buffer.used >= flushSize.load(std::memory_order_relaxed))) {
+            flushBuffer(buffer);
+        }
+    }
+
+    void bufferFormat(OutputBuffer &buffer, const char *format, va_list args, bool newLine) {
+        // format directly to free space of buffer, bigger output is formatted to temporary memory
+        va_list copy;
+        va_copy(copy, args);
+        int64_t free = buffer.capacity - buffer.used;
+        int size = vsnprintf(buffer.data + buffer.used, free, format, copy);
+        va_end(copy);
+        if (size < 0) {
+            return;
+        }
+
+        if (size < free) {
+            buffer.used += size;
+            if (newLine) {
+                bufferWrite(buffer, "\n", 1);
+            } else if (buffer.mode == FlushMode::LINE && memchr(buffer.data + buffer.used - size, '\n', size)) {
+                flushBuffer(buffer);
+            }
+            return;
+        }
+
+        std::vector<char> text(size + 1);
+        vsnprintf(text.data(), text.size(), format, args);
+        if (newLine) {
+            text[size++] = '\n';
+        }
+        bufferWrite(buffer, text.data(), size);
+    }
+
+    void bufferOutput(const char *str, int64_t size) {
+        if (output.data == nullptr) {
+            initOutput();
+        }
+        bufferWrite(output, str, size);
+    }
+
+    void formatOutput(const char *format, va_list args, bool newLine) {
+        if (output.data == nullptr) {
+            initOutput();
+        }
+        bufferFormat(output, format, args, newLine);
+    }
+}
+
 extern "C" DECLSPEC void fprint(FILE *const stream, char *str, va_list args) {
+    if (stream == stdout) {
+        formatOutput(str, args, false);
+        return;
+    }
     vfprintf(stream, str, args);
 }
 
 extern "C" DECLSPEC void fprintln(FILE *const stream, char *str, va_list args) {
-    char *out = (char *) malloc(strlen(str) + 2);
-    strcpy(out, str);
-    strcat(out, "\n");
-    vfprintf(stream, out, args);
-    free(out);
+    if (stream == stdout) {
+        formatOutput(str, args, true);
+        return;
+    }
+    vfprintf(stream, str, args);
+    fputc('\n', stream);
 }
 
-extern "C" DECLSPEC int read() {
-    return getchar();
+extern "C" DECLSPEC void flush() {
+    flushOutput();
 }
 
-extern "C" DECLSPEC char *readLine() {
-    char *line = (char *) malloc(100);
-    char *linep = line;
-    line = line + sizeof(int64_t);
-    size_t lenmax = 100, len = lenmax;
-    size_t size = 0;
+extern "C" DECLSPEC void __mlang_output_mode(int64_t mode, int64_t size) {
+    flushMode.store(mode, std::memory_order_relaxed);
+    if (size > 0) {
+        flushSize.store(size, std::memory_order_relaxed);
+    }
+}
 
-    int c;
+/**
+ * Typed writes of print and println with format compiled by compiler
+ */
+extern "C" DECLSPEC void __mlang_write(const char *str, int64_t size) {
+    bufferOutput(str, size);
+}
 
-    if (line == nullptr)
-        return nullptr;
+extern "C" DECLSPEC void __mlang_write_string(const char *str) {
+    if (str == nullptr) {
+        __mlang_write("(null)", 6);
+        return;
+    }
+    __mlang_write(str, len((char *) str));
+}
 
-    for (;;) {
-        c = fgetc(stdin);
-        if (c == EOF)
-            break;
+extern "C" DECLSPEC void __mlang_write_int(int64_t val) {
+    char buffer[MAX_NUMBER_CHARS];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), val);
+    __mlang_write(buffer, result.ptr - buffer);
+}
 
-        if (--len == 0) {
-            len = lenmax;
-            char *linen = (char *) realloc(linep, lenmax *= 2);
+extern "C" DECLSPEC void __mlang_write_double(double val) {
+    // same as %f, largest double has 309 digits
+    char buffer[512];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), val, std::chars_format::fixed, 6);
+    __mlang_write(buffer, result.ptr - buffer);
+}
 
-            if (linen == nullptr) {
-                free(linep);
-                return nullptr;
+extern "C" DECLSPEC void __mlang_write_char(char c) {
+    __mlang_write(&c, 1);
+}
+
+/**
+ * File output (openWrite, write, writeLine, writeArray, close)
+ * file handle is index of file in table, every file has its own large buffer
+ */
+namespace {
+    constexpr int64_t FILE_BUFFER_SIZE = 1024 * 1024;
+
+    struct OutputFile {
+        FILE *file;
+        OutputBuffer buffer;
+    };
+
+    std::vector<OutputFile *> outputFiles;
+
+    OutputFile *outputFile(int64_t handle) {
+        if (handle < 0 || handle >= (int64_t) outputFiles.size() || outputFiles[handle] == nullptr) {
+            __mlang_error((int) RuntimeError::INVALID_FILE_HANDLE);
+        }
+        return outputFiles[handle];
+    }
+
+    void closeFile(OutputFile *file) {
+        flushBuffer(file->buffer);
+#ifdef _WIN32
+        CloseHandle(file->buffer.descriptor);
+#else
+        fclose(file->file);
+#endif
+        free(file->buffer.data);
+        delete file;
+    }
+
+    void closeFiles() {
+        for (auto &file : outputFiles) {
+            if (file != nullptr) {
+                closeFile(file);
+                file = nullptr;
             }
-            line = linen + (line - linep);
-            linep = linen;
         }
+    }
+}
 
-        size++;
-        if ((*line++ = c) == '\n')
-            break;
+extern "C" DECLSPEC int64_t __mlang_open_write(const char *path) {
+    auto file = new OutputFile{};
+#ifdef _WIN32
+    file->buffer.descriptor = CreateFileA(path, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL,
+                                          nullptr);
+    bool opened = file->buffer.descriptor != INVALID_HANDLE_VALUE;
+#else
+    // file is written by writev to its descriptor, stdio only opens and closes it
+    file->file = fopen(path, "wb");
+    bool opened = file->file != nullptr;
+    if (opened) {
+        file->buffer.descriptor = fileno(file->file);
+    }
+#endif
+    file->buffer.data = opened ? (char *) malloc(FILE_BUFFER_SIZE) : nullptr;
+    if (file->buffer.data == nullptr) {
+        __mlang_error((int) RuntimeError::CANNOT_OPEN_FILE);
+    }
+    file->buffer.capacity = FILE_BUFFER_SIZE;
+    file->buffer.mode = FlushMode::FULL;
+
+    if (outputFiles.empty()) {
+        atexit(closeFiles);
     }
-    *line = '\0';
-    size++;
-    *((int64_t *) (linep)) = size;
+    outputFiles.push_back(file);
+    return (int64_t) outputFiles.size() - 1;
+}
+
+extern "C" DECLSPEC void __mlang_file_write(int64_t handle, char *str, ...) {
+    va_list argp;
+    va_start(argp, str);
+    bufferFormat(outputFile(handle)->buffer, str, argp, false);
+    va_end(argp);
+}
+
+extern "C" DECLSPEC void __mlang_file_write_line(int64_t handle, char *str, ...) {
+    va_list argp;
+    va_start(argp, str);
+    bufferFormat(outputFile(handle)->buffer, str, argp, true);
+    va_end(argp);
+}
+
+extern "C" DECLSPEC void __mlang_file_write_array(int64_t handle, const char *data, int64_t size) {
+    auto &buffer = outputFile(handle)->buffer;
+    if (buffer.used + size <= buffer.capacity) {
+        bufferWrite(buffer, data, size);
+        return;
+    }
+    // buffered text and array are written together, array is not copied
+    writeOutput(buffer.descriptor, buffer.data, buffer.used, data, size);
+    buffer.used = 0;
+}
+
+extern "C" DECLSPEC void __mlang_file_close(int64_t handle) {
+    closeFile(outputFile(handle));
+    outputFiles[handle] = nullptr;
+}
 
-    char *linen = (char *) realloc(linep, size + sizeof(int64_t));
-    if (linen == nullptr) {
-        free(linep);
+/**
+ * Input of read, readLine, readAll and stdinLines
+ * stdin is read in large blocks, lines are found by memchr, so no byte is read separately
+ */
+namespace {
+    constexpr int64_t INPUT_BUFFER_SIZE = 1024 * 1024;
+
+    struct InputBuffer {
+        char *data{nullptr};
+        int64_t start{0}; // first not consumed byte
+        int64_t end{0};
+        int64_t capacity{0};
+        bool eof{false};
+    };
+
+    InputBuffer input;
+    char *lineBuffer{nullptr}; // String reused by every line of stdinLines
+
+    int64_t readInput(char *data, int64_t size) {
+#ifdef _WIN32
+        DWORD count = 0;
+        if (!ReadFile(GetStdHandle(STD_INPUT_HANDLE), data, (DWORD) std::min<int64_t>(size, INT32_MAX), &count,
+                      nullptr)) {
+            return 0;
+        }
+        return count;
+#else
+        iovec part{data, (size_t) size};
+        return readv(0, &part, 1);
+#endif
+    }
+
+    /**
+     * Read next block of stdin after buffered data, buffer grows when it is full of not consumed data
+     * @return false on end of input
+     */
+    bool fillInput() {
+        if (input.eof) {
+            return false;
+        }
+        if (input.data == nullptr) {
+            input.data = (char *) malloc(INPUT_BUFFER_SIZE);
+            if (input.data == nullptr) {
+                input.eof = true;
+                return false;
+            }
+            input.capacity = INPUT_BUFFER_SIZE;
+        }
+
+        if (input.start > 0) {
+            memmove(input.data, input.data + input.start, input.end - input.start);
+            input.end -= input.start;
+            input.start = 0;
+        }
+        if (input.end == input.capacity) {
+            auto data = (char *) realloc(input.data, input.capacity * 2);
+            if (data == nullptr) {
+                input.eof = true;
+                return false;
+            }
+            input.data = data;
+            input.capacity *= 2;
+        }
+
+        int64_t count = readInput(input.data + input.end, input.capacity - input.end);
+        if (count <= 0) {
+            input.eof = true;
+            return false;
+        }
+        input.end += count;
+        return true;
+    }
+
+    /**
+     * Buffer whole next line
+     * @return length of line including new line character (0 at end of input)
+     */
+    int64_t bufferLine() {
+        // prompt must be visible before program waits for input
+        flushOutput();
+        int64_t scanned = 0;
+        for (;;) {
+            char *start = input.data + input.start;
+            auto newLine = (char *) memchr(start + scanned, '\n', input.end - input.start - scanned);
+            if (newLine != nullptr) {
+                return newLine - start + 1;
+            }
+            scanned = input.end - input.start;
+            if (!fillInput()) {
+                return input.end - input.start;
+            }
+        }
+    }
+
+    bool isSpace(char c) {
+        return c == ' ' || (c >= '\t' && c <= '\r');
+    }
+
+    /**
+     * Skip white spaces and buffer whole next token
+     * @return length of token (0 at end of input)
+     */
+    int64_t bufferToken() {
+        flushOutput();
+        for (;;) {
+            while (input.start < input.end && isSpace(input.data[input.start])) {
+                input.start++;
+            }
+            if (input.start == input.end) {
+                if (!fillInput()) {
+                    return 0;
+                }
+                continue;
+            }
+
+            int64_t end = input.start;
+            while (end < input.end && !isSpace(input.data[end])) {
+                end++;
+            }
+            // token can continue in next block, it is scanned again after fill (which moves it to buffer start)
+            int64_t length = end - input.start;
+            if (end < input.end || !fillInput()) {
+                return length;
+            }
+        }
+    }
+}
+
+extern "C" DECLSPEC int read() {
+    flushOutput();
+    if (input.start == input.end && !fillInput()) {
+        return EOF;
+    }
+    return (unsigned char) input.data[input.start++];
+}
+
+extern "C" DECLSPEC char *readLine() {
+    int64_t length = bufferLine();
+
+    // result must be allocated by runtime allocator, so it can be released by rm
+    int64_t size = length + 1;
+    char *result = __mlang_alloc(size + sizeof(int64_t));
+    if (result == nullptr) {
         return nullptr;
     }
-    line = linen + (line - linep);
-    linep = linen;
+    *((int64_t *) result) = size;
+    memcpy(result + sizeof(int64_t), input.data + input.start, length);
+    input.start += length;
 
-    return linep + sizeof(int64_t);
+    return result + sizeof(int64_t);
 }
 
 extern "C" DECLSPEC int64_t sizeOf(int64_t *ptr) {
@@ -98,114 +536,832 @@ extern "C" DECLSPEC int64_t sizeOf(int64_t *ptr) {
 
 extern "C" DECLSPEC int64_t len(char *ptr) {
     int64_t size = sizeOf((int64_t *) ptr);
+    return __mlang_len(ptr, size);
+}
+
+extern "C" DECLSPEC int64_t __mlang_len(const char *ptr, int64_t size) {
     return strnlen(ptr, size);
 }
 
+/**
+ * Runtime allocator
+ * every block has hidden 8 byte header with its size class (and reference count) before memory returned by __mlang_alloc,
+ * small blocks are reused from thread local free lists, large blocks are allocated by calloc
+ * (with their capacity before header), huge blocks (above threshold) are mapped from os
+ */
+namespace {
+    struct BlockHeader {
+        int32_t sizeClass;
+        int32_t refs; // reference count (--arc), negative for static memory which is never freed
+    };
+
+    constexpr int64_t ALLOC_HEADER_SIZE = sizeof(BlockHeader);
+    constexpr int SIZE_CLASSES = 10; // 32 B - 16 KB
+    constexpr int64_t MIN_BLOCK_SIZE = 32;
+    constexpr int64_t MAX_SMALL_BLOCK_SIZE = MIN_BLOCK_SIZE << (SIZE_CLASSES - 1);
+    constexpr int64_t CHUNK_SIZE = 256 * 1024;
+    constexpr int32_t LARGE_BLOCK = -1;
+
+    struct FreeBlock {
+        FreeBlock *next;
+    };
+
+    struct ThreadHeap {
+        FreeBlock *freeLists[SIZE_CLASSES]{};
+        char *chunk{nullptr}; // zeroed memory for new small blocks
+        int64_t chunkLeft{0};
+    };
+
+    thread_local ThreadHeap heap;
+
+    BlockHeader *blockHeader(char *ptr) {
+        // ptr points after array size
+        return (BlockHeader *) (ptr - sizeof(int64_t) - ALLOC_HEADER_SIZE);
+    }
+
+    int sizeClass(int64_t blockSize) {
+        int sizeClass = 0;
+        for (int64_t classSize = MIN_BLOCK_SIZE; classSize < blockSize; classSize <<= 1) {
+            sizeClass++;
+        }
+        return sizeClass;
+    }
+}
+
+/**
+ * Huge arrays
+ * blocks above threshold are mapped directly from os, pages are zeroed lazily by kernel when they are first touched,
+ * array data starts at 2 MB boundary (sizeOf header is just before it) so it can be backed by transparent huge pages
+ */
+namespace {
+    constexpr int32_t HUGE_BLOCK = -2;
+    constexpr int64_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+    constexpr int64_t PAGE_SIZE = 4096;
+
+    struct HugeMapping {
+        char *base;
+        int64_t length;
+    };
+
+    std::atomic<int64_t> hugeThreshold{4 * 1024 * 1024};
+
+    char *alignUp(char *ptr, int64_t alignment) {
+        return (char *) (((uintptr_t) ptr + alignment - 1) & ~(uintptr_t) (alignment - 1));
+    }
+
+    HugeMapping *hugeMapping(BlockHeader *block) {
+        return (HugeMapping *) block - 1;
+    }
+
+    BlockHeader *hugeAlloc(int64_t size) {
+        int64_t dataSize = size - (int64_t) sizeof(int64_t);
+        // one page for headers before data and padding to align data
+        int64_t length = PAGE_SIZE + HUGE_PAGE_SIZE + dataSize;
+#ifdef _WIN32
+        // large pages need SeLockMemoryPrivilege, committed pages are zero filled on demand
+        auto base = (char *) VirtualAlloc(nullptr, length, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+        if (base == nullptr) {
+            return nullptr;
+        }
+        char *data = alignUp(base + PAGE_SIZE, HUGE_PAGE_SIZE);
+#else
+        auto base = (char *) mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED) {
+            return nullptr;
+        }
+        char *data = alignUp(base + PAGE_SIZE, HUGE_PAGE_SIZE);
+
+        // unmap alignment padding, only header page before data is kept
+        char *start = data - PAGE_SIZE;
+        char *end = alignUp(data + dataSize, PAGE_SIZE);
+        if (start > base) {
+            munmap(base, start - base);
+        }
+        if (end < base + length) {
+            munmap(end, base + length - end);
+        }
+        base = start;
+        length = end - start;
+#ifdef MADV_HUGEPAGE
+        madvise(data, end - data, MADV_HUGEPAGE);
+#endif
+#endif
+        auto block = (BlockHeader *) (data - sizeof(int64_t) - ALLOC_HEADER_SIZE);
+        auto mapping = hugeMapping(block);
+        mapping->base = base;
+        mapping->length = length;
+        block->sizeClass = HUGE_BLOCK;
+        block->refs = 0;
+        return block;
+    }
+
+    void hugeFree(BlockHeader *block) {
+        auto mapping = hugeMapping(block);
+#ifdef _WIN32
+        VirtualFree(mapping->base, 0, MEM_RELEASE);
+#else
+        munmap(mapping->base, mapping->length);
+#endif
+    }
+}
+
+extern "C" DECLSPEC void __mlang_huge_threshold(int64_t size) {
+    hugeThreshold.store(size, std::memory_order_relaxed);
+}
+
+/**
+ * Mapped files
+ * file is mapped after header page of huge block, so String is not copied and it is released by rm as huge array,
+ * rest of last page (or next zero page) terminates String by null
+ */
+namespace {
+    BlockHeader *mapFile(FILE *file, int64_t fileSize) {
+        int64_t length = PAGE_SIZE + (fileSize + PAGE_SIZE) / PAGE_SIZE * PAGE_SIZE;
+#ifdef _WIN32
+        // view of file cannot be placed after header page, file is read to committed memory
+        auto base = (char *) VirtualAlloc(nullptr, length, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+        if (base == nullptr) {
+            return nullptr;
+        }
+        if ((int64_t) fread(base + PAGE_SIZE, 1, fileSize, file) != fileSize) {
+            VirtualFree(base, 0, MEM_RELEASE);
+            return nullptr;
+        }
+#else
+        auto base = (char *) mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED) {
+            return nullptr;
+        }
+        // private mapping, changes of String are not written to file
+        if (fileSize > 0 && mmap(base + PAGE_SIZE, fileSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED,
+                                 fileno(file), 0) == MAP_FAILED) {
+            munmap(base, length);
+            return nullptr;
+        }
+#endif
+        char *data = base + PAGE_SIZE;
+        auto block = (BlockHeader *) (data - sizeof(int64_t) - ALLOC_HEADER_SIZE);
+        auto mapping = hugeMapping(block);
+        mapping->base = base;
+        mapping->length = length;
+        block->sizeClass = HUGE_BLOCK;
+        block->refs = 0;
+        ((int64_t *) data)[-1] = fileSize;
+        return block;
+    }
+}
+
+extern "C" DECLSPEC char *readFile(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (file == nullptr) {
+        __mlang_error((int) RuntimeError::CANNOT_OPEN_FILE);
+    }
+
+#ifdef _WIN32
+    _fseeki64(file, 0, SEEK_END);
+    int64_t fileSize = _ftelli64(file);
+    _fseeki64(file, 0, SEEK_SET);
+#else
+    struct stat info{};
+    int64_t fileSize = fstat(fileno(file), &info) == 0 ? info.st_size : -1;
+#endif
+
+    BlockHeader *block = fileSize >= 0 ? mapFile(file, fileSize) : nullptr;
+    fclose(file);
+    if (block == nullptr) {
+        __mlang_error((int) RuntimeError::CANNOT_OPEN_FILE);
+    }
+    return (char *) (block + 1) + sizeof(int64_t);
+}
+
+/**
+ * Heap profiler (--heap-profile)
+ * allocations are counted per call site, site is constant string 'function;file:line' generated by compiler
+ */
+namespace {
+    struct HeapSiteStats {
+        int64_t count{0};
+        int64_t bytes{0};
+        int64_t live{0};
+        int64_t peak{0};
+    };
+
+    struct HeapProfile {
+        std::mutex mutex;
+        std::map<const char *, HeapSiteStats> sites;
+        std::unordered_map<char *, std::pair<HeapSiteStats *, int64_t>> blocks; // site and size of live block
+    };
+
+    std::atomic<bool> heapProfileActive{false};
+
+    HeapProfile &heapProfile() {
+        static auto profile = new HeapProfile(); // NOLINT, must outlive program exit
+        return *profile;
+    }
+
+    void heapProfileFree(char *ptr) {
+        auto &profile = heapProfile();
+        std::lock_guard<std::mutex> lock(profile.mutex);
+        auto block = profile.blocks.find(ptr);
+        if (block != profile.blocks.end()) {
+            block->second.first->live -= block->second.second;
+            profile.blocks.erase(block);
+        }
+    }
+
+    /**
+     * Move profiled block of grown array to its new memory, growth is counted to site of the array
+     */
+    void heapProfileMove(char *from, char *to, int64_t size) {
+        auto &profile = heapProfile();
+        std::lock_guard<std::mutex> lock(profile.mutex);
+        auto block = profile.blocks.find(from);
+        if (block == profile.blocks.end()) {
+            return;
+        }
+        auto stats = block->second.first;
+        int64_t grown = size - block->second.second;
+        stats->bytes += grown;
+        stats->live += grown;
+        stats->peak = std::max(stats->peak, stats->live);
+        profile.blocks.erase(block);
+        profile.blocks[to] = {stats, size};
+    }
+}
+
 extern "C" DECLSPEC void __mlang_rm(char *ptr) {
-    free(ptr - 8);
+    if (ptr == nullptr) {
+        return;
+    }
+    if (heapProfileActive.load(std::memory_order_relaxed)) {
+        heapProfileFree(ptr);
+    }
+
+    auto block = blockHeader(ptr);
+    if (block->sizeClass == LARGE_BLOCK) {
+        free((int64_t *) block - 1);
+        return;
+    }
+    if (block->sizeClass == HUGE_BLOCK) {
+        hugeFree(block);
+        return;
+    }
+
+    auto freeBlock = (FreeBlock *) block;
+    auto &freeList = heap.freeLists[block->sizeClass];
+    freeBlock->next = freeList;
+    freeList = freeBlock;
 }
 
 extern "C" DECLSPEC char *__mlang_alloc(int64_t size) {
-    char *mem = (char *) malloc(size);
-    memset(mem, 0, size);
+    int64_t blockSize = size + ALLOC_HEADER_SIZE;
+    BlockHeader *block;
+
+    if (size >= hugeThreshold.load(std::memory_order_relaxed) && blockSize > MAX_SMALL_BLOCK_SIZE) {
+        block = hugeAlloc(size);
+        return block != nullptr ? (char *) (block + 1) : nullptr;
+    }
+
+    if (blockSize > MAX_SMALL_BLOCK_SIZE) {
+        // calloc gets fresh pages already zeroed by os, no memset is needed
+        auto large = (int64_t *) calloc(1, sizeof(int64_t) + blockSize);
+        if (large == nullptr) {
+            return nullptr;
+        }
+        large[0] = size;
+        block = (BlockHeader *) (large + 1);
+        block->sizeClass = LARGE_BLOCK;
+        return (char *) (block + 1);
+    }
+
+    int blockClass = sizeClass(blockSize);
+    auto &freeList = heap.freeLists[blockClass];
+    if (freeList != nullptr) {
+        block = (BlockHeader *) freeList;
+        freeList = freeList->next;
+        memset(block, 0, blockSize);
+    } else {
+        int64_t classSize = MIN_BLOCK_SIZE << blockClass;
+        if (heap.chunkLeft < classSize) {
+            // rest of old chunk is left unused
+            heap.chunk = (char *) calloc(1, CHUNK_SIZE);
+            if (heap.chunk == nullptr) {
+                heap.chunkLeft = 0;
+                return nullptr;
+            }
+            heap.chunkLeft = CHUNK_SIZE;
+        }
+        block = (BlockHeader *) heap.chunk;
+        heap.chunk += classSize;
+        heap.chunkLeft -= classSize;
+    }
+
+    block->sizeClass = blockClass;
+    block->refs = 0;
+    return (char *) (block + 1);
+}
+
+/**
+ * Growable arrays
+ * capacity is given by allocator block, array grows geometrically so push is amortized O(1)
+ */
+namespace {
+    int64_t blockCapacity(BlockHeader *block) {
+        switch (block->sizeClass) {
+            case LARGE_BLOCK:
+                return ((int64_t *) block)[-1];
+            case HUGE_BLOCK: {
+                auto mapping = hugeMapping(block);
+                return mapping->base + mapping->length - (char *) (block + 1);
+            }
+            default:
+                return (MIN_BLOCK_SIZE << block->sizeClass) - ALLOC_HEADER_SIZE;
+        }
+    }
+
+    char *growArray(char *ptr, int64_t itemSize, int64_t count) {
+        if (ptr == nullptr) {
+            // not initialized array is empty
+            char *mem = __mlang_alloc(count * itemSize + (int64_t) sizeof(int64_t));
+            return mem != nullptr ? mem + sizeof(int64_t) : nullptr;
+        }
+
+        auto block = blockHeader(ptr);
+        int64_t size = ((int64_t *) ptr)[-1];
+        int64_t capacity = (blockCapacity(block) - (int64_t) sizeof(int64_t)) / itemSize;
+        if (count <= capacity) {
+            return ptr;
+        }
+
+        // moved array is seen only by the variable which is resized, other holders would point to freed memory
+        if (block->refs > 1) {
+            __mlang_error((int) RuntimeError::SHARED_ARRAY_RESIZE);
+        }
+
+        count = std::max(count, capacity * 2);
+        int64_t allocSize = count * itemSize + (int64_t) sizeof(int64_t);
+        bool profiled = heapProfileActive.load(std::memory_order_relaxed);
+
+        if (block->sizeClass == LARGE_BLOCK && allocSize < hugeThreshold.load(std::memory_order_relaxed)) {
+            // realloc extends block in place when memory after it is free
+            auto large = (int64_t *) realloc((int64_t *) block - 1, sizeof(int64_t) + ALLOC_HEADER_SIZE + allocSize);
+            if (large == nullptr) {
+                return nullptr;
+            }
+            large[0] = allocSize;
+            char *grown = (char *) (large + 1) + ALLOC_HEADER_SIZE + sizeof(int64_t);
+            if (profiled) {
+                heapProfileMove(ptr, grown, allocSize);
+            }
+            return grown;
+        }
+
+        char *mem = __mlang_alloc(allocSize);
+        if (mem == nullptr) {
+            return nullptr;
+        }
+        memcpy(mem, ptr - sizeof(int64_t), sizeof(int64_t) + size * itemSize);
+        // single holder (or runtime for static block) is moved with the array
+        blockHeader(mem + sizeof(int64_t))->refs = block->refs;
+        if (profiled) {
+            heapProfileMove(ptr, mem + sizeof(int64_t), allocSize);
+        }
+        __mlang_rm(ptr);
+        return mem + sizeof(int64_t);
+    }
+}
+
+extern "C" DECLSPEC char *__mlang_push(char *ptr, int64_t itemSize) {
+    int64_t size = ptr != nullptr ? ((int64_t *) ptr)[-1] : 0;
+    ptr = growArray(ptr, itemSize, size + 1);
+    if (ptr != nullptr) {
+        ((int64_t *) ptr)[-1] = size + 1;
+    }
+    return ptr;
+}
+
+extern "C" DECLSPEC char *__mlang_reserve(char *ptr, int64_t itemSize, int64_t count) {
+    return growArray(ptr, itemSize, count);
+}
+
+namespace {
+    int64_t arrayCapacity(char *ptr) {
+        return blockCapacity(blockHeader(ptr)) - (int64_t) sizeof(int64_t);
+    }
+}
+
+extern "C" DECLSPEC char *readAll() {
+    flushOutput();
+    int64_t size = input.end - input.start;
+    char *result = __mlang_reserve(nullptr, 1, std::max<int64_t>(size + 1, INPUT_BUFFER_SIZE));
+    if (result == nullptr) {
+        return nullptr;
+    }
+    if (size > 0) {
+        memcpy(result, input.data + input.start, size);
+    }
+    input.start = input.end;
+
+    // rest of input is read directly to result, which grows geometrically
+    while (!input.eof) {
+        int64_t capacity = arrayCapacity(result) - 1;
+        if (size == capacity) {
+            ((int64_t *) result)[-1] = size;
+            char *grown = __mlang_reserve(result, 1, size + 2);
+            if (grown == nullptr) {
+                __mlang_rm(result);
+                return nullptr;
+            }
+            result = grown;
+            continue;
+        }
+        int64_t count = readInput(result + size, capacity - size);
+        if (count <= 0) {
+            input.eof = true;
+            break;
+        }
+        size += count;
+    }
+
+    result[size] = '\0';
+    ((int64_t *) result)[-1] = size;
+    return result;
+}
+
+extern "C" DECLSPEC char *__mlang_next_line() {
+    int64_t length = bufferLine();
+    if (length == 0) {
+        return nullptr;
+    }
+
+    char *line = input.data + input.start;
+    input.start += length;
+    // line is without new line characters
+    if (line[length - 1] == '\n') {
+        length--;
+    }
+    if (length > 0 && line[length - 1] == '\r') {
+        length--;
+    }
+
+    if (lineBuffer == nullptr || arrayCapacity(lineBuffer) < length + 1) {
+        lineBuffer = __mlang_reserve(lineBuffer, 1, length + 1);
+        if (lineBuffer == nullptr) {
+            return nullptr;
+        }
+        // line buffer is owned by runtime, reference counting never frees it
+        blockHeader(lineBuffer)->refs = -1;
+    }
+    memcpy(lineBuffer, line, length);
+    lineBuffer[length] = '\0';
+    ((int64_t *) lineBuffer)[-1] = length;
+    return lineBuffer;
+}
+
+/**
+ * Numeric scanner (readInt, readDouble, readToken, parseInts)
+ * numbers are parsed in place of input buffer or String, eight digits at once (SWAR)
+ */
+namespace {
+    char *tokenBuffer{nullptr}; // String reused by every readToken
+
+    bool isDigit(char c) {
+        return c >= '0' && c <= '9';
+    }
+
+    bool isEightDigits(uint64_t chunk) {
+        // every byte is 0x30 - 0x39
+        return (chunk & 0xF0F0F0F0F0F0F0F0) == 0x3030303030303030 &&
+               ((chunk + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) == 0x3030303030303030;
+    }
+
+    uint64_t parseEightDigits(uint64_t chunk) {
+        // first digit is in lowest byte, pairs, quads and then all eight digits are combined by multiplication
+        chunk -= 0x3030303030303030;
+        chunk = (chunk * 10) + (chunk >> 8);
+        return (((chunk & 0x000000FF000000FF) * 0x000F424000000064) +
+                (((chunk >> 16) & 0x000000FF000000FF) * 0x0000271000000001)) >> 32;
+    }
+
+    constexpr uint64_t INT_LIMIT = (uint64_t) INT64_MAX + 1; // magnitude of min Int
+
+    /**
+     * Parse digits from first, first is moved after them
+     * value saturates at INT_LIMIT, so too long number is parsed as max (or min) Int
+     */
+    uint64_t parseDigits(const char *&first, const char *last) {
+        uint64_t value = 0;
+        while (last - first >= 8) {
+            uint64_t chunk;
+            memcpy(&chunk, first, sizeof(chunk));
+            if (!isEightDigits(chunk)) {
+                break;
+            }
+            uint64_t digits = parseEightDigits(chunk);
+            value = value <= (INT_LIMIT - digits) / 100000000 ? value * 100000000 + digits : INT_LIMIT;
+            first += 8;
+        }
+        while (first != last && isDigit(*first)) {
+            uint64_t digit = *first - '0';
+            value = value <= (INT_LIMIT - digit) / 10 ? value * 10 + digit : INT_LIMIT;
+            first++;
+        }
+        return value;
+    }
+
+    int64_t parseInt(const char *&first, const char *last) {
+        bool negative = first != last && *first == '-';
+        if (first != last && (*first == '-' || *first == '+')) {
+            first++;
+        }
+        uint64_t value = parseDigits(first, last);
+        if (negative) {
+            return value == INT_LIMIT ? INT64_MIN : -(int64_t) value;
+        }
+        return value == INT_LIMIT ? INT64_MAX : (int64_t) value;
+    }
+}
+
+extern "C" DECLSPEC bool inputEnd() {
+    flushOutput();
+    // white spaces are only looked at, so following readLine still gets rest of current line
+    int64_t scanned = 0;
+    for (;;) {
+        while (input.start + scanned < input.end && isSpace(input.data[input.start + scanned])) {
+            scanned++;
+        }
+        if (input.start + scanned < input.end) {
+            return false;
+        }
+        // fill moves buffered input to buffer start, scanned is relative to it
+        if (!fillInput()) {
+            return true;
+        }
+    }
+}
+
+extern "C" DECLSPEC int64_t readInt() {
+    int64_t length = bufferToken();
+    const char *first = input.data + input.start;
+    input.start += length;
+    return length > 0 ? parseInt(first, first + length) : 0;
+}
+
+extern "C" DECLSPEC double readDouble() {
+    int64_t length = bufferToken();
+    const char *first = input.data + input.start;
+    const char *last = first + length;
+    input.start += length;
+    // from_chars does not accept leading plus sign
+    if (first != last && *first == '+') {
+        first++;
+    }
+    double value = 0;
+    std::from_chars(first, last, value);
+    return value;
+}
+
+extern "C" DECLSPEC char *readToken() {
+    int64_t length = bufferToken();
+    if (tokenBuffer == nullptr || arrayCapacity(tokenBuffer) < length + 1) {
+        tokenBuffer = __mlang_reserve(tokenBuffer, 1, length + 1);
+        if (tokenBuffer == nullptr) {
+            return nullptr;
+        }
+        // token buffer is owned by runtime, reference counting never frees it
+        blockHeader(tokenBuffer)->refs = -1;
+    }
+    memcpy(tokenBuffer, input.data + input.start, length);
+    input.start += length;
+    tokenBuffer[length] = '\0';
+    ((int64_t *) tokenBuffer)[-1] = length;
+    return tokenBuffer;
+}
+
+extern "C" DECLSPEC int64_t *__mlang_parse_ints(const char *str, int64_t size) {
+    const char *first = str;
+    const char *last = str + size;
+    // numbers are separated by any other characters, array grows like by push
+    auto numbers = (int64_t *) __mlang_reserve(nullptr, sizeof(int64_t), size / 8 + 16);
+    int64_t count = 0;
+    int64_t capacity = arrayCapacity((char *) numbers) / (int64_t) sizeof(int64_t);
+
+    while (numbers != nullptr) {
+        while (first != last && !isDigit(*first) &&
+               !((*first == '-' || *first == '+') && last - first > 1 && isDigit(first[1]))) {
+            first++;
+        }
+        if (first == last) {
+            break;
+        }
+
+        if (count == capacity) {
+            numbers[-1] = count;
+            numbers = (int64_t *) __mlang_reserve((char *) numbers, sizeof(int64_t), count + 1);
+            if (numbers == nullptr) {
+                return nullptr;
+            }
+            capacity = arrayCapacity((char *) numbers) / (int64_t) sizeof(int64_t);
+        }
+        numbers[count++] = parseInt(first, last);
+    }
+
+    if (numbers != nullptr) {
+        numbers[-1] = count;
+    }
+    return numbers;
+}
+
+/**
+ * Reference counting (--arc)
+ * new block has no reference, every variable holding it is one reference,
+ * block is freed when last reference is released (or when dropped without any reference)
+ */
+extern "C" DECLSPEC void __mlang_retain(char *ptr) {
+    if (ptr == nullptr) {
+        return;
+    }
+    auto block = blockHeader(ptr);
+    if (block->refs >= 0) {
+        block->refs++;
+    }
+}
+
+extern "C" DECLSPEC void __mlang_release(char *ptr) {
+    if (ptr == nullptr) {
+        return;
+    }
+    auto block = blockHeader(ptr);
+    if (block->refs >= 0 && --block->refs <= 0) {
+        __mlang_rm(ptr);
+    }
+}
+
+extern "C" DECLSPEC void __mlang_unretain(char *ptr) {
+    if (ptr == nullptr) {
+        return;
+    }
+    auto block = blockHeader(ptr);
+    if (block->refs > 0) {
+        block->refs--;
+    }
+}
+
+extern "C" DECLSPEC void __mlang_drop(char *ptr) {
+    if (ptr != nullptr && blockHeader(ptr)->refs == 0) {
+        __mlang_rm(ptr);
+    }
+}
+
+extern "C" DECLSPEC char *__mlang_alloc_site(int64_t size, const char *site) {
+    char *mem = __mlang_alloc(size);
+    if (mem == nullptr) {
+        return nullptr;
+    }
+
+    heapProfileActive.store(true, std::memory_order_relaxed);
+    auto &profile = heapProfile();
+    std::lock_guard<std::mutex> lock(profile.mutex);
+    auto &stats = profile.sites[site];
+    stats.count++;
+    stats.bytes += size;
+    stats.live += size;
+    stats.peak = std::max(stats.peak, stats.live);
+    // rm is called with pointer after array size
+    profile.blocks[mem + sizeof(int64_t)] = {&stats, size};
     return mem;
 }
 
+extern "C" DECLSPEC void __mlang_heap_report(const char *foldedFile) {
+    auto &profile = heapProfile();
+    std::lock_guard<std::mutex> lock(profile.mutex);
+
+    std::vector<std::pair<const char *, HeapSiteStats>> sites(profile.sites.begin(), profile.sites.end());
+    std::sort(sites.begin(), sites.end(), [](auto &a, auto &b) { return a.second.bytes > b.second.bytes; });
+
+    flushOutput();
+    fprintf(stderr, "\nHeap profile:\n%12s %14s %14s %14s  %s\n", "count", "bytes", "live bytes", "peak bytes", "site");
+    for (auto &site : sites) {
+        fprintf(stderr, "%12lld %14lld %14lld %14lld  %s\n", (long long) site.second.count,
+                (long long) site.second.bytes, (long long) site.second.live, (long long) site.second.peak,
+                site.first);
+    }
+
+    // flamegraph folded stacks, value is allocated bytes
+    if (foldedFile != nullptr) {
+        FILE *folded = fopen(foldedFile, "w");
+        if (folded == nullptr) {
+            fprintf(stderr, "Could not write heap profile %s\n", foldedFile);
+            return;
+        }
+        for (auto &site : sites) {
+            fprintf(folded, "%s %lld\n", site.first, (long long) site.second.bytes);
+        }
+        fclose(folded);
+        fprintf(stderr, "Folded heap profile written to %s\n", foldedFile);
+    }
+}
+
 
 std::string errors[] = { // NOLINT(cert-err58-cpp)
         "Invalid sizeof usage!\n",
-        "Index out of range!\n"
+        "Index out of range!\n",
+        "Cannot open file!\n",
+        "Invalid file handle!\n",
+        "Array shared by more variables cannot be resized!\n"
 };
 
 extern "C" DECLSPEC int __mlang_error(int error) {
+    flushOutput();
     std::cout << errors[error];
     exit(1);
 }
 
+/**
+ * Number/string conversions
+ * result String is written directly to space from compiler (8 byte size header and characters),
+ * no memory is allocated
+ */
+namespace {
+    void *stringResult(void *space, char *end) {
+        auto buffer = (char *) space;
+        *((int64_t *) buffer) = end - (buffer + sizeof(int64_t));
+        *end = '\0';
+        return buffer;
+    }
+
+    const char *skipSpaces(const char *first, const char *last) {
+        while (first != last && isspace((unsigned char) *first)) {
+            first++;
+        }
+        // from_chars does not accept leading plus sign
+        if (first != last && *first == '+') {
+            first++;
+        }
+        return first;
+    }
+
+    const char *stringEnd(const char *str) {
+        return str + strnlen(str, ((int64_t *) str)[-1]);
+    }
+}
+
 extern "C" DECLSPEC void *__mlang_cast(long long val, int fTy, int fBit, int tTy, int tBit, void *space) {
     if (tTy == 14) {
         // toString
         if (fTy == 12) {
             // int type
-            char *c = nullptr;
-            size_t size = 0;
+            char *first = (char *) space + sizeof(int64_t);
             switch (fBit) {
                 case 1: {
-                    auto str = std::string(((bool) val) ? "true" : "false");
-                    size = str.size();
-                    c = new char[size];
-                    strcpy(c, str.c_str());
-                    break;
+                    const char *str = ((bool) val) ? "true" : "false";
+                    size_t size = strlen(str);
+                    memcpy(first, str, size);
+                    return stringResult(space, first + size);
                 }
                 case 8: {
-                    size = 1;
-                    c = new char[size];
-                    c[0] = (char) val;
-                    break;
+                    first[0] = (char) val;
+                    return stringResult(space, first + 1);
                 }
                 case 64: {
-                    auto str = std::to_string(val);
-                    size = str.size();
-                    c = new char[size];
-                    strcpy(c, str.c_str());
-                    break;
+                    auto result = std::to_chars(first, first + MAX_NUMBER_CHARS, (int64_t) val);
+                    return stringResult(space, result.ptr);
                 }
+                default:
+                    return nullptr;
             }
-
-            if (c == nullptr) {
-                return nullptr;
-            }
-
-            int s = size;
-            char *sizeParts = new char[8]{0};
-
-            for (int i = 0; i < 8; ++i) {
-                sizeParts[i] = s & 0xff;
-                s >>= 8;
-            }
-
-            char *buffer = (char *) space;
-            std::copy(sizeParts, sizeParts + 8, buffer);
-            std::copy(c, c + size, buffer + 8);
-            buffer[size + 8] = '\0';
-            delete[] c;
-
-            return buffer;
         }
     } else {
         // from String
+        auto str = (const char *) val;
 
         if (tTy == 12) {
             // in type
             switch (tBit) {
                 case 1: {
-                    char *str = (char *) val;
-                    int *i = (int *) space;
-                    if (strcmp(str, "true") != 0) {
-                        i[0] = 0;
-                    } else {
-                        i[0] = 1;
-                    }
-                    return i;
+                    *((bool *) space) = strcmp(str, "true") == 0;
+                    return space;
                 }
                 case 8: {
                     return (char *) val;
                 }
                 case 64: {
-                    int *i = (int *) space;
-                    int ii = std::stoi((char *) val);
-                    i[0] = ii;
-                    return i;
+                    const char *last = stringEnd(str);
+                    int64_t i = 0;
+                    std::from_chars(skipSpaces(str, last), last, i);
+                    *((int64_t *) space) = i;
+                    return space;
                 }
                 default:
                     return nullptr;
             }
         } else if (tTy == 3) {
             // double ty
-            auto *d = (double *) space;
-            double dd = std::stod((char *) val);
-            d[0] = dd;
-            return d;
+            const char *last = stringEnd(str);
+            double d = 0;
+            std::from_chars(skipSpaces(str, last), last, d);
+            *((double *) space) = d;
+            return space;
         }
 
     }
@@ -217,28 +1373,10 @@ extern "C" DECLSPEC void *__mlang_castd(double val, int fTy, int tTy, void *spac
     if (tTy == 14) {
         // toString
         if (fTy == 3) {
-            // double ty
-            auto str = std::to_string((double) val);
-            size_t size = str.size();
-            char *c = new char[size];
-            strcpy(c, str.c_str());
-
-            size_t s = size;
-            char *sizeParts = new char[8]{0};
-
-            for (int i = 0; i < 8; ++i) {
-                sizeParts[i] = s & 0xff;
-                s >>= 8;
-            }
-
-            char *buffer = (char *) space;
-            std::copy(sizeParts, sizeParts + 8, buffer);
-            std::copy(c, c + size, buffer + 8);
-            buffer[size + 8] = '\0';
-            delete[] c;
-
-
-            return buffer;
+            // double ty, shortest representation which is parsed back to same value
+            char *first = (char *) space + sizeof(int64_t);
+            auto result = std::to_chars(first, first + MAX_NUMBER_CHARS, val);
+            return stringResult(space, result.ptr);
         }
     }
 
@@ -246,9 +1384,10 @@ extern "C" DECLSPEC void *__mlang_castd(double val, int fTy, int tTy, void *spac
 }
 
 extern "C" DECLSPEC int64_t __mlang_scompare(const char *s1, const char *s2) {
-    size_t len1 = ((int64_t *) s1)[-1];
-    size_t len2 = ((int64_t *) s2)[-1];
+    return __mlang_scompare_n(s1, ((int64_t *) s1)[-1], s2, ((int64_t *) s2)[-1]);
+}
 
+extern "C" DECLSPEC int64_t __mlang_scompare_n(const char *s1, int64_t len1, const char *s2, int64_t len2) {
     int cmp = std::strncmp(s1, s2, std::min(len1, len2));
 
     if (cmp == 0 && len1 != len2) {
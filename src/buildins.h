@@ -20,32 +20,109 @@ extern "C" DECLSPEC void fprint(FILE *stream, char *str, va_list args);
 
 extern "C" DECLSPEC void fprintln(FILE *stream, char *str, va_list args);
 
+/**
+ * When buffered output of print and println is written to stdout (AUTO is LINE for terminal, otherwise FULL)
+ */
+enum class FlushMode : int64_t {
+    AUTO, LINE, FULL, SIZE
+};
+
+extern "C" DECLSPEC void flush();
+
+extern "C" DECLSPEC void __mlang_output_mode(int64_t mode, int64_t size);
+
+extern "C" DECLSPEC void __mlang_write(const char *str, int64_t size);
+
+extern "C" DECLSPEC void __mlang_write_string(const char *str);
+
+extern "C" DECLSPEC void __mlang_write_int(int64_t val);
+
+extern "C" DECLSPEC void __mlang_write_double(double val);
+
+extern "C" DECLSPEC void __mlang_write_char(char c);
+
+extern "C" DECLSPEC int64_t __mlang_open_write(const char *path);
+
+extern "C" DECLSPEC void __mlang_file_write(int64_t handle, char *str, ...);
+
+extern "C" DECLSPEC void __mlang_file_write_line(int64_t handle, char *str, ...);
+
+extern "C" DECLSPEC void __mlang_file_write_array(int64_t handle, const char *data, int64_t size);
+
+extern "C" DECLSPEC void __mlang_file_close(int64_t handle);
+
 extern "C" DECLSPEC int read();
 
 extern "C" DECLSPEC char *readLine();
 
+extern "C" DECLSPEC char *readAll();
+
+extern "C" DECLSPEC char *__mlang_next_line();
+
+extern "C" DECLSPEC bool inputEnd();
+
+extern "C" DECLSPEC int64_t readInt();
+
+extern "C" DECLSPEC double readDouble();
+
+extern "C" DECLSPEC char *readToken();
+
+extern "C" DECLSPEC int64_t *__mlang_parse_ints(const char *str, int64_t size);
+
 extern "C" DECLSPEC int64_t sizeOf(int64_t *ptr);
 
 extern "C" DECLSPEC int64_t len(char *ptr);
 
+extern "C" DECLSPEC int64_t __mlang_len(const char *ptr, int64_t size);
+
 extern "C" DECLSPEC void __mlang_rm(char *ptr);
 
 extern "C" DECLSPEC char *__mlang_alloc(int64_t size);
 
+extern "C" DECLSPEC void __mlang_huge_threshold(int64_t size);
+
+extern "C" DECLSPEC char *readFile(const char *path);
+
+extern "C" DECLSPEC char *__mlang_push(char *ptr, int64_t itemSize);
+
+extern "C" DECLSPEC char *__mlang_reserve(char *ptr, int64_t itemSize, int64_t count);
+
+extern "C" DECLSPEC void __mlang_retain(char *ptr);
+
+extern "C" DECLSPEC void __mlang_release(char *ptr);
+
+extern "C" DECLSPEC void __mlang_unretain(char *ptr);
+
+extern "C" DECLSPEC void __mlang_drop(char *ptr);
+
+extern "C" DECLSPEC char *__mlang_alloc_site(int64_t size, const char *site);
+
+extern "C" DECLSPEC void __mlang_heap_report(const char *foldedFile);
+
 enum class RuntimeError {
     INVALID_SIZEOF_USAGE,
-    INDEX_OUT_OF_RANGE
+    INDEX_OUT_OF_RANGE,
+    CANNOT_OPEN_FILE,
+    INVALID_FILE_HANDLE,
+    SHARED_ARRAY_RESIZE
 };
 
 
 extern "C" DECLSPEC int __mlang_error(int error);
 
+/**
+ * Max characters of number converted to String (shortest double representation, e.g. -1.7976931348623157e+308)
+ */
+constexpr int64_t MAX_NUMBER_CHARS = 24;
+
 extern "C" DECLSPEC void *__mlang_cast(long long val, int fTy, int fBit, int tTy, int tBit, void *space);
 
 extern "C" DECLSPEC void *__mlang_castd(double val, int fTy, int tTy, void *space);
 
 extern "C" DECLSPEC int64_t __mlang_scompare(const char *s1, const char *s2);
 
+extern "C" DECLSPEC int64_t __mlang_scompare_n(const char *s1, int64_t len1, const char *s2, int64_t len2);
+
 extern "C" DECLSPEC void __mlang_copy(char *dest, const char *source, int64_t size, int64_t offset);
 
 #endif /* MLANG_BUILDINS_H */
@@ -9,6 +9,18 @@
 
 namespace mlang {
 
+    /**
+     * Heap space for string result of cast (size header and characters)
+     * escape analysis moves it to stack when string does not leave function
+     */
+    static llvm::Value *createStringSpace(CodeGenContext &context, const YYLTYPE &location) {
+        auto charType = llvm::Type::getInt8Ty(context.getGlobalContext());
+        auto space = context.createMallocCall(charType, sizeof(int64_t) + MAX_NUMBER_CHARS + 1, "space", nullptr,
+                                              &location);
+        return llvm::CastInst::CreatePointerCast(space, llvm::Type::getInt8PtrTy(context.getGlobalContext()),
+                                                 "cast_tmp", context.currentBlock());
+    }
+
     llvm::Value *Cast::codeGen(CodeGenContext &context) {
         llvm::Value *val = expr->codeGen(context);
 
@@ -51,8 +63,7 @@ namespace mlang {
                                                             llvm::Type::getDoubleTy(context.getGlobalContext()),
                                                             intType, intType, ptrType));
 
-            llvm::Value *space = new llvm::AllocaInst(llvm::ArrayType::get(llvm::Type::getInt8Ty(context.getGlobalContext()), 20), 0, "space", context.currentBlock());
-            space = llvm::CastInst::CreatePointerCast(space, llvm::Type::getInt8PtrTy(context.getGlobalContext()), "cast_tmp", context.currentBlock());
+            llvm::Value *space = createStringSpace(context, location);
 
             fargs.push_back(val);
             fargs.push_back((new Integer((int) valTy->getTypeID()))->codeGen(context));
@@ -64,8 +75,7 @@ namespace mlang {
 
             llvm::Value *space;
             if(type->isPointerTy()) {
-                space = new llvm::AllocaInst(llvm::ArrayType::get(llvm::Type::getInt8Ty(context.getGlobalContext()), 20), 0, "space", context.currentBlock());
-                space = llvm::CastInst::CreatePointerCast(space, llvm::Type::getInt8PtrTy(context.getGlobalContext()), "cast_tmp", context.currentBlock());
+                space = createStringSpace(context, location);
             } else {
                 space = new llvm::AllocaInst(type, 0, "space", context.currentBlock());
                 space = llvm::CastInst::CreatePointerCast(space, llvm::Type::getInt8PtrTy(context.getGlobalContext()), "cast_tmp", context.currentBlock());
@@ -83,9 +93,11 @@ namespace mlang {
         }
 
         llvm::Value *castPtr = llvm::CallInst::Create(fun, fargs, "cast", context.currentBlock());
+        context.createArcCall("__mlang_drop", val);
 
         if (!valTy->isPointerTy()) {
-            auto ispace = new llvm::BitCastInst(castPtr, llvm::Type::getInt64PtrTy(context.getGlobalContext()), "tmp", context.currentBlock());
+            // string is written to space, which is also returned (space is used, so escape analysis can follow it)
+            auto ispace = new llvm::BitCastInst(fargs.back(), llvm::Type::getInt64PtrTy(context.getGlobalContext()), "tmp", context.currentBlock());
 
             llvm::Value *indices[1] = {llvm::ConstantInt::get(llvm::Type::getInt64Ty(context.getGlobalContext()), 1)};
             llvm::Value *elementPtr = llvm::GetElementPtrInst::Create(nullptr, ispace, indices, "elem_ptr",
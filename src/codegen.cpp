@@ -9,19 +9,49 @@
 
 #pragma warning(push, 0)
 
-#include <llvm/ExecutionEngine/MCJIT.h>
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/CompileUtils.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/CodeGen/ParallelCG.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/Transforms/IPO/Internalize.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Host.h>
+#include <llvm/MC/SubtargetFeature.h>
+#include <llvm/Target/TargetMachine.h>
+#include <llvm/Target/TargetOptions.h>
 #include <llvm-c/Core.h>
 #include <llvm/IR/Verifier.h>
 
+#if LLVM_VERSION_MAJOR >= 14
+#include <llvm/MC/TargetRegistry.h>
+#else
+#include <llvm/Support/TargetRegistry.h>
+#endif
+
 #pragma warning(pop)
 
 #include "codegen.h"
+#include "timing.h"
+#include "escape.h"
 
 #define MAKE_LLVM_EXTERNAL_NAME(a) #a
 
+#if LLVM_VERSION_MAJOR >= 14
+using LLVMOptLevel = llvm::OptimizationLevel;
+#else
+using LLVMOptLevel = llvm::PassBuilder::OptimizationLevel;
+#endif
+
 namespace mlang {
 
-    CodeGenContext::CodeGenContext(std::ostream &outs, bool debug, bool run) : outs(outs), debug(debug), run(run) {
+    CodeGenContext::CodeGenContext(std::ostream &outs, bool debug, bool run, OptLevel optLevel)
+            : outs(outs), debug(debug), run(run), optLevel(optLevel), threadSafeContext(std::make_unique<llvm::LLVMContext>()),
+              llvmContext(*threadSafeContext.getContext()) {
         llvm::InitializeNativeTarget();
         llvm::InitializeNativeTargetAsmParser();
         llvm::InitializeNativeTargetAsmPrinter();
@@ -132,6 +162,15 @@ namespace mlang {
         llvmTypeMap["var"] = varType;
         llvmTypeMap["val"] = valType;
 
+        // slice is view (data pointer and size) to part of array or string
+        for (auto &slice : std::vector<std::pair<std::string, llvm::Type *>>{
+                {"StringSlice", stringType}, {"IntSlice", intArrayType}, {"DoubleSlice", doubleArrayType},
+                {"BoolSlice", boolArrayType}}) {
+            auto sliceType = llvm::StructType::create(getGlobalContext(), {slice.second, intType}, slice.first);
+            sliceTypes[slice.second] = sliceType;
+            llvmTypeMap[slice.first] = sliceType;
+        }
+
         arrayFunctions["String"] = stringType;
         arrayFunctions["IntArray"] = intArrayType;
         arrayFunctions["DoubleArray"] = doubleArrayType;
@@ -143,6 +182,17 @@ namespace mlang {
         castFunctions["toChar"] = charType;
         castFunctions["toString"] = stringType;
 
+        dynamicArrayFunctions["push"] = DynamicArray::Operation::PUSH;
+        dynamicArrayFunctions["pop"] = DynamicArray::Operation::POP;
+        dynamicArrayFunctions["reserve"] = DynamicArray::Operation::RESERVE;
+        dynamicArrayFunctions["clear"] = DynamicArray::Operation::CLEAR;
+
+        fileFunctions["openWrite"] = FileOutput::Operation::OPEN;
+        fileFunctions["write"] = FileOutput::Operation::WRITE;
+        fileFunctions["writeLine"] = FileOutput::Operation::WRITE_LINE;
+        fileFunctions["writeArray"] = FileOutput::Operation::WRITE_ARRAY;
+        fileFunctions["close"] = FileOutput::Operation::CLOSE;
+
         std::vector<llvm::Type *> argTypesOneInt(1, intType);
         std::vector<llvm::Type *> argTypesInt8Ptr(1, llvm::Type::getInt8PtrTy(getGlobalContext()));
         std::vector<llvm::Type *> argTypesInt64Ptr(1, llvm::Type::getInt64PtrTy(getGlobalContext()));
@@ -155,7 +205,7 @@ namespace mlang {
         if (i != f->arg_end()) {
             i->setName("format_str");
         }
-        buildins.push_back({f, (void *) print});
+        buildins.push_back({f->getName().str(), (void *) print});
 
         ft = llvm::FunctionType::get(llvm::Type::getVoidTy(getGlobalContext()), argTypesInt8Ptr, true);
         f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, MAKE_LLVM_EXTERNAL_NAME(println), getModule());
@@ -163,72 +213,299 @@ namespace mlang {
         if (i != f->arg_end()) {
             i->setName("format_str");
         }
-        buildins.push_back({f, (void *) println});
+        buildins.push_back({f->getName().str(), (void *) println});
+
+
+        std::vector<llvm::Type *> writeTypes {stringType, intType};
+        ft = llvm::FunctionType::get(voidType, writeTypes, false);
+        f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, MAKE_LLVM_EXTERNAL_NAME(__mlang_write),
+                                   getModule());
+        buildins.push_back({f->getName().str(), (void *) __mlang_write});
+
+        ft = llvm::FunctionType::get(voidType, argTypesInt8Ptr, false);
+        f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, MAKE_LLVM_EXTERNAL_NAME(__mlang_write_string),
+                                   getModule());
+        buildins.push_back({f->getName().str(), (void *) __mlang_write_string});
+
+        ft = llvm::FunctionType::get(voidType, argTypesOneInt, false);
+        f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, MAKE_LLVM_EXTERNAL_NAME(__mlang_write_int),
+                                   getModule());
+        buildins.push_back({f->getName().str(), (void *) __mlang_write_int});
+
+        ft = llvm::FunctionType::get(voidType, {doubleType}, false);
+        f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, MAKE_LLVM_EXTERNAL_NAME(__mlang_write_double),
+                                   getModule());
+        buildins.push_back({f->getName().str(), (void *) __mlang_write_double});
+
+        ft = llvm::FunctionType::get(voidType, {charType}, false);
+        f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, MAKE_LLVM_EXTERNAL_NAME(__mlang_write_char),
+                                   getModule());
+        buildins.push_back({f->getName().str(), (void *) __mlang_write_char});
+
+        ft = llvm::FunctionType::get(intType, argTypesInt8Ptr, false);
+        f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, MAKE_LLVM_EXTERNAL_NAME(__mlang_open_write),
+                                   getModule());
+        buildins.push_back({f->getName().str(), (void *) __mlang_open_write});
+
+        std::vector<llvm::Type *> fileWriteTypes{intType, stringType};
+        ft = llvm::FunctionType::get(voidType, fileWriteTypes, true);
+        f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, MAKE_LLVM_EXTERNAL_NAME(__mlang_file_write),
+                                   getModule());
+        buildins.push_back({f->getName().str(), (void *) __mlang_file_write});
+
+        f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage,
+                                   MAKE_LLVM_EXTERNAL_NAME(__mlang_file_write_line), getModule());
+        buildins.push_back({f->getName().str(), (void *) __mlang_file_write_line});
 
+        ft = llvm::FunctionType::get(voidType, {intType, stringType, intType}, false);
+        f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage,
+                                   MAKE_LLVM_EXTERNAL_NAME(__mlang_file_write_array), getModule());
+        buildins.push_back({f->getName().str(), (void *) __mlang_file_write_array});
+
+        ft = llvm::FunctionType::get(voidType, argTypesOneInt, false);
+        f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, MAKE_LLVM_EXTERNAL_NAME(__mlang_file_close),
+                                   getModule());
+        buildins.push_back({f->getName().str(), (void *) __mlang_file_close});
 
         ft = llvm::FunctionType::get(llvm::Type::getInt8Ty(getGlobalContext()), false);
         f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, MAKE_LLVM_EXTERNAL_NAME(read), getModule());
-        buildins.push_back({f, (void *) read});
+        buildins.push_back({f->getName().str(), (void *) read});
 
         ft = llvm::FunctionType::get(llvm::Type::getInt8PtrTy(getGlobalContext()), false);
         f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, MAKE_LLVM_EXTERNAL_NAME(readLine), getModule());
-        buildins.push_back({f, (void *) readLine});
+        buildins.push_back({f->getName().str(), (void *) readLine});
+
+        ft = llvm::FunctionType::get(llvm::Type::getInt8PtrTy(getGlobalContext()), false);
+        f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, MAKE_LLVM_EXTERNAL_NAME(readAll), getModule());
+        buildins.push_back({f->getName().str(), (void *) readAll});
+
+        ft = llvm::FunctionType::get(llvm::Type::getInt8PtrTy(getGlobalContext()), false);
+        f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, MAKE_LLVM_EXTERNAL_NAME(__mlang_next_line),
+                                   getModule());
+        buildins.push_back({f->getName().str(), (void *) __mlang_next_line});
+
+        ft = llvm::FunctionType::get(boolType, false);
+        f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, MAKE_LLVM_EXTERNAL_NAME(inputEnd), getModule());
+        buildins.push_back({f->getName().str(), (void *) inputEnd});
+
+        ft = llvm::FunctionType::get(intType, false);
+        f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, MAKE_LLVM_EXTERNAL_NAME(readInt), getModule());
+        buildins.push_back({f->getName().str(), (void *) readInt});
+
+        ft = llvm::FunctionType::get(doubleType, false);
+        f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, MAKE_LLVM_EXTERNAL_NAME(readDouble), getModule());
+        buildins.push_back({f->getName().str(), (void *) readDouble});
+
+        ft = llvm::FunctionType::get(stringType, false);
+        f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, MAKE_LLVM_EXTERNAL_NAME(readToken), getModule());
+        buildins.push_back({f->getName().str(), (void *) readToken});
+
+        ft = llvm::FunctionType::get(intArrayType, {stringType, intType}, false);
+        f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, MAKE_LLVM_EXTERNAL_NAME(__mlang_parse_ints),
+                                   getModule());
+        buildins.push_back({f->getName().str(), (void *) __mlang_parse_ints});
+
+        ft = llvm::FunctionType::get(llvm::Type::getInt8PtrTy(getGlobalContext()), argTypesInt8Ptr, false);
+        f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, MAKE_LLVM_EXTERNAL_NAME(readFile), getModule());
+        buildins.push_back({f->getName().str(), (void *) readFile});
 
         ft = llvm::FunctionType::get(llvm::Type::getInt64Ty(getGlobalContext()), argTypesInt64Ptr, false);
         f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, MAKE_LLVM_EXTERNAL_NAME(sizeOf), getModule());
-        buildins.push_back({f, (void *) sizeOf});
+        buildins.push_back({f->getName().str(), (void *) sizeOf});
 
         ft = llvm::FunctionType::get(llvm::Type::getVoidTy(getGlobalContext()), argTypesInt8Ptr, false);
         f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, MAKE_LLVM_EXTERNAL_NAME(__mlang_error),
                                    getModule());
-        buildins.push_back({f, (void *) __mlang_error});
+        buildins.push_back({f->getName().str(), (void *) __mlang_error});
 
         ft = llvm::FunctionType::get(llvm::Type::getVoidTy(getGlobalContext()), argTypesInt8Ptr, false);
         f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, MAKE_LLVM_EXTERNAL_NAME(__mlang_rm),
                                    getModule());
-        buildins.push_back({f, (void *) __mlang_rm});
+        buildins.push_back({f->getName().str(), (void *) __mlang_rm});
 
         ft = llvm::FunctionType::get(llvm::Type::getInt8PtrTy(getGlobalContext()), argTypesOneInt, false);
         f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, MAKE_LLVM_EXTERNAL_NAME(__mlang_alloc),
                                    getModule());
-        buildins.push_back({f, (void *) __mlang_alloc});
+        buildins.push_back({f->getName().str(), (void *) __mlang_alloc});
+
+        ft = llvm::FunctionType::get(voidType, argTypesOneInt, false);
+        f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, MAKE_LLVM_EXTERNAL_NAME(__mlang_huge_threshold),
+                                   getModule());
+        buildins.push_back({f->getName().str(), (void *) __mlang_huge_threshold});
+
+        ft = llvm::FunctionType::get(voidType, false);
+        f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, MAKE_LLVM_EXTERNAL_NAME(flush), getModule());
+        buildins.push_back({f->getName().str(), (void *) flush});
+
+        ft = llvm::FunctionType::get(voidType, {intType, intType}, false);
+        f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, MAKE_LLVM_EXTERNAL_NAME(__mlang_output_mode),
+                                   getModule());
+        buildins.push_back({f->getName().str(), (void *) __mlang_output_mode});
+
+        std::vector<llvm::Type *> lenTypes {stringType, intType};
+        ft = llvm::FunctionType::get(intType, lenTypes, false);
+        f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, MAKE_LLVM_EXTERNAL_NAME(__mlang_len),
+                                   getModule());
+        buildins.push_back({f->getName().str(), (void *) __mlang_len});
+
+        std::vector<llvm::Type *> compareTypes {stringType, intType, stringType, intType};
+        ft = llvm::FunctionType::get(intType, compareTypes, false);
+        f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, MAKE_LLVM_EXTERNAL_NAME(__mlang_scompare_n),
+                                   getModule());
+        buildins.push_back({f->getName().str(), (void *) __mlang_scompare_n});
+
+        std::vector<llvm::Type *> pushTypes {stringType, intType};
+        ft = llvm::FunctionType::get(stringType, pushTypes, false);
+        f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, MAKE_LLVM_EXTERNAL_NAME(__mlang_push),
+                                   getModule());
+        buildins.push_back({f->getName().str(), (void *) __mlang_push});
+
+        std::vector<llvm::Type *> reserveTypes {stringType, intType, intType};
+        ft = llvm::FunctionType::get(stringType, reserveTypes, false);
+        f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, MAKE_LLVM_EXTERNAL_NAME(__mlang_reserve),
+                                   getModule());
+        buildins.push_back({f->getName().str(), (void *) __mlang_reserve});
+
+        ft = llvm::FunctionType::get(voidType, argTypesInt8Ptr, false);
+        f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, MAKE_LLVM_EXTERNAL_NAME(__mlang_retain),
+                                   getModule());
+        buildins.push_back({f->getName().str(), (void *) __mlang_retain});
+
+        f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, MAKE_LLVM_EXTERNAL_NAME(__mlang_release),
+                                   getModule());
+        buildins.push_back({f->getName().str(), (void *) __mlang_release});
+
+        f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, MAKE_LLVM_EXTERNAL_NAME(__mlang_unretain),
+                                   getModule());
+        buildins.push_back({f->getName().str(), (void *) __mlang_unretain});
+
+        f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, MAKE_LLVM_EXTERNAL_NAME(__mlang_drop),
+                                   getModule());
+        buildins.push_back({f->getName().str(), (void *) __mlang_drop});
+
+        std::vector<llvm::Type *> allocSiteTypes {intType, stringType};
+        ft = llvm::FunctionType::get(llvm::Type::getInt8PtrTy(getGlobalContext()), allocSiteTypes, false);
+        f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, MAKE_LLVM_EXTERNAL_NAME(__mlang_alloc_site),
+                                   getModule());
+        buildins.push_back({f->getName().str(), (void *) __mlang_alloc_site});
+
+        ft = llvm::FunctionType::get(voidType, argTypesInt8Ptr, false);
+        f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, MAKE_LLVM_EXTERNAL_NAME(__mlang_heap_report),
+                                   getModule());
+        buildins.push_back({f->getName().str(), (void *) __mlang_heap_report});
 
         std::vector<llvm::Type *> castTypes {intType, intType, intType, intType, intType, stringType};
         ft = llvm::FunctionType::get(llvm::Type::getInt8PtrTy(getGlobalContext()), castTypes, false);
         f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, MAKE_LLVM_EXTERNAL_NAME(__mlang_cast),
                                    getModule());
-        buildins.push_back({f, (void *) __mlang_cast});
+        buildins.push_back({f->getName().str(), (void *) __mlang_cast});
 
         std::vector<llvm::Type *> castTypesd {doubleType, intType, intType, stringType};
         ft = llvm::FunctionType::get(llvm::Type::getInt8PtrTy(getGlobalContext()), castTypesd, false);
         f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, MAKE_LLVM_EXTERNAL_NAME(__mlang_castd),
                                    getModule());
-        buildins.push_back({f, (void *) __mlang_castd});
+        buildins.push_back({f->getName().str(), (void *) __mlang_castd});
 
         std::vector<llvm::Type *> scompareTypes {stringType, stringType};
         ft = llvm::FunctionType::get(llvm::Type::getInt64Ty(getGlobalContext()), scompareTypes, false);
         f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, MAKE_LLVM_EXTERNAL_NAME(__mlang_scompare),getModule());
-        buildins.push_back({f, (void *) __mlang_scompare});
+        buildins.push_back({f->getName().str(), (void *) __mlang_scompare});
 
         ft = llvm::FunctionType::get(llvm::Type::getInt64Ty(getGlobalContext()), argTypesInt8Ptr, false);
         f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, MAKE_LLVM_EXTERNAL_NAME(len),getModule());
-        buildins.push_back({f, (void *) len});
+        buildins.push_back({f->getName().str(), (void *) len});
 
         std::vector<llvm::Type *> copyTypes {stringType, stringType, intType, intType};
         ft = llvm::FunctionType::get(voidType, copyTypes, false);
         f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, MAKE_LLVM_EXTERNAL_NAME(__mlang_copy),getModule());
-        buildins.push_back({f, (void *) __mlang_copy});
+        buildins.push_back({f->getName().str(), (void *) __mlang_copy});
+    }
+
+    /**
+     * Get name of function if ir unit is function
+     */
+    static std::string traceFunctionName(llvm::Any ir) {
+        if (llvm::any_isa<const llvm::Function *>(ir)) {
+            return llvm::any_cast<const llvm::Function *>(ir)->getName().str();
+        }
+        return std::string();
+    }
+
+    static void addTraceCallbacks(llvm::PassInstrumentationCallbacks &callbacks) {
+#if LLVM_VERSION_MAJOR >= 12
+        callbacks.registerBeforeNonSkippedPassCallback([](llvm::StringRef pass, llvm::Any ir) {
+            llvm::timeTraceProfilerBegin(pass, traceFunctionName(ir));
+        });
+        callbacks.registerAfterPassCallback([](llvm::StringRef, llvm::Any, const llvm::PreservedAnalyses &) {
+            llvm::timeTraceProfilerEnd();
+        });
+        callbacks.registerAfterPassInvalidatedCallback([](llvm::StringRef, const llvm::PreservedAnalyses &) {
+            llvm::timeTraceProfilerEnd();
+        });
+#else
+        callbacks.registerBeforePassCallback([](llvm::StringRef pass, llvm::Any ir) {
+            llvm::timeTraceProfilerBegin(pass, traceFunctionName(ir));
+            return true;
+        });
+        callbacks.registerAfterPassCallback([](llvm::StringRef, llvm::Any) {
+            llvm::timeTraceProfilerEnd();
+        });
+        callbacks.registerAfterPassInvalidatedCallback([](llvm::StringRef) {
+            llvm::timeTraceProfilerEnd();
+        });
+#endif
     }
 
     void CodeGenContext::optimize() {
-        llvm::legacy::FunctionPassManager fpm(getModule());
-        llvm::PassManagerBuilder pmbuilder;
-        pmbuilder.OptLevel = 3;
-        pmbuilder.populateFunctionPassManager(fpm);
-        for (auto &fn : getModule()->getFunctionList()) {
-            fpm.run(fn);
+        LLVMOptLevel level = LLVMOptLevel::O3;
+        switch (optLevel) {
+            case OptLevel::O0:
+                return;
+            case OptLevel::O1:
+                level = LLVMOptLevel::O1;
+                break;
+            case OptLevel::O2:
+                level = LLVMOptLevel::O2;
+                break;
+            case OptLevel::O3:
+                level = LLVMOptLevel::O3;
+                break;
+            case OptLevel::Os:
+                level = LLVMOptLevel::Os;
+                break;
+        }
+
+        llvm::LoopAnalysisManager lam;
+        llvm::FunctionAnalysisManager fam;
+        llvm::CGSCCAnalysisManager cgam;
+        llvm::ModuleAnalysisManager mam;
+
+        PhaseScope phase("Optimize");
+
+        // trace span for every pass run on function
+        llvm::PassInstrumentationCallbacks callbacks;
+        if (Timing::isTraceEnabled()) {
+            addTraceCallbacks(callbacks);
+        }
+
+        // instrumentation (profile is written when program exits) or optimization using collected profile
+        llvm::Optional<llvm::PGOOptions> pgoOptions;
+        if (!profileGenerate.empty()) {
+            pgoOptions = llvm::PGOOptions(profileGenerate, "", "", llvm::PGOOptions::IRInstr);
+        } else if (!profileUse.empty()) {
+            pgoOptions = llvm::PGOOptions(profileUse, "", "", llvm::PGOOptions::IRUse);
         }
-        fpm.run(*initFunction);
+
+        // target machine enables target specific cost models (vectorizer, unroll, inline)
+        llvm::PassBuilder passBuilder(targetMachine.get(), llvm::PipelineTuningOptions(), pgoOptions, &callbacks);
+        passBuilder.registerModuleAnalyses(mam);
+        passBuilder.registerCGSCCAnalyses(cgam);
+        passBuilder.registerFunctionAnalyses(fam);
+        passBuilder.registerLoopAnalyses(lam);
+        passBuilder.crossRegisterProxies(lam, fam, cgam, mam);
+
+        llvm::ModulePassManager mpm = passBuilder.buildPerModuleDefaultPipeline(level);
+        mpm.run(*getModule(), mam);
     }
 
     void CodeGenContext::initMainFunction() {
@@ -240,13 +517,18 @@ namespace mlang {
 
         std::vector<llvm::Type *> argTypes;
         llvm::FunctionType *ftype = llvm::FunctionType::get(llvm::Type::getVoidTy(getGlobalContext()), argTypes, false);
-        initFunction = llvm::Function::Create(ftype, llvm::GlobalValue::InternalLinkage, "__mlang_init_fun",getModule());
+        // init function must be visible for JIT symbol lookup
+        auto initLinkage = run ? llvm::GlobalValue::ExternalLinkage : llvm::GlobalValue::InternalLinkage;
+        initFunction = llvm::Function::Create(ftype, initLinkage, "__mlang_init_fun", getModule());
         llvm::BasicBlock *bblock = llvm::BasicBlock::Create(getGlobalContext(), "entry", initFunction, nullptr);
         setUpBuildIns();
 
         newScope(bblock, ScopeType::GLOBAL_BLOCK);
 
-        root.codeGen(*this);
+        {
+            PhaseScope phase("Codegen");
+            root.codeGen(*this);
+        }
         if (errors > 0) {
             outs << "Compilation error(s). Abort.\n";
             return false;
@@ -268,9 +550,29 @@ namespace mlang {
             endScope();
         }
 
+        if (arc) {
+            PhaseScope phase("Reference counting");
+            ReferenceCounting(*module, arcVariables, initFunction).run();
+        }
+
+        if (heapProfile) {
+            addHeapReport();
+        }
+
+        if (hugeThreshold >= 0) {
+            addHugeThreshold();
+        }
+
+        addOutputFlush();
+
         std::string verifyOutputString;
         llvm::raw_string_ostream verifyOutputStream(verifyOutputString);
-        if (llvm::verifyModule(*getModule(), &verifyOutputStream)) {
+        bool broken;
+        {
+            PhaseScope phase("Verify");
+            broken = llvm::verifyModule(*getModule(), &verifyOutputStream);
+        }
+        if (broken) {
             verifyOutputStream.flush();
             if (debug) {
                 outs << LLVMPrintModuleToString((LLVMModuleRef) module);
@@ -279,40 +581,447 @@ namespace mlang {
             return false;
         }
 
-        if (!debug) {
-            optimize();
+        // small arrays (and toString results) are moved to stack at every level, optimizer also frees bigger ones,
+        // with reference counting every array is already freed when it is not used
+        {
+            PhaseScope phase("Escape analysis");
+            EscapeAnalysis(*module, optLevel != OptLevel::O0 && !arc).run();
+        }
+
+        // jit resolves build-ins to compiler's own functions, runtime linked into jit module would keep
+        // its globals unconstructed and register exit handlers in jit memory freed before exit
+        if (!runtimePath.empty() && !run) {
+            runtimeLinked = linkRuntime();
         }
 
+        if (!configureTarget()) {
+            return false;
+        }
+
+        optimize();
+
         return true;
     }
 
+    void CodeGenContext::addHeapReport() {
+        auto fun = module->getOrInsertFunction("__mlang_heap_report", voidType, stringType);
+        auto entry = mainFunction != nullptr ? mainFunction : initFunction;
+
+        std::vector<llvm::ReturnInst *> returns;
+        for (auto &block : *entry) {
+            if (auto ret = llvm::dyn_cast_or_null<llvm::ReturnInst>(block.getTerminator())) {
+                returns.push_back(ret);
+            }
+        }
+
+        for (auto ret : returns) {
+            std::vector<llvm::Value *> fargs;
+            fargs.push_back(createStringConstant(heapProfileFile, ".heap_profile"));
+            llvm::CallInst::Create(fun, fargs, "", ret);
+        }
+    }
+
+    void CodeGenContext::addHugeThreshold() {
+        auto fun = module->getOrInsertFunction("__mlang_huge_threshold", voidType, intType);
+        auto entry = mainFunction != nullptr ? mainFunction : initFunction;
+
+        std::vector<llvm::Value *> fargs;
+        fargs.push_back(llvm::ConstantInt::get(intType, hugeThreshold));
+        llvm::CallInst::Create(fun, fargs, "", &*entry->getEntryBlock().getFirstInsertionPt());
+    }
+
+    void CodeGenContext::addOutputFlush() {
+        auto entry = mainFunction != nullptr ? mainFunction : initFunction;
+
+        if (flushMode != FlushMode::AUTO) {
+            auto mode = module->getOrInsertFunction("__mlang_output_mode", voidType, intType, intType);
+            std::vector<llvm::Value *> fargs;
+            fargs.push_back(llvm::ConstantInt::get(intType, (int64_t) flushMode));
+            fargs.push_back(llvm::ConstantInt::get(intType, flushSize));
+            llvm::CallInst::Create(mode, fargs, "", &*entry->getEntryBlock().getFirstInsertionPt());
+        }
+
+        // buffered output is written before program ends (exit of process flushes it too, but jit returns to compiler)
+        auto fun = module->getOrInsertFunction("flush", voidType);
+        for (auto &block : *entry) {
+            if (auto ret = llvm::dyn_cast_or_null<llvm::ReturnInst>(block.getTerminator())) {
+                llvm::CallInst::Create(fun, "", ret);
+            }
+        }
+    }
+
+    llvm::Constant *CodeGenContext::getStringLiteral(const std::string &value) {
+        auto &literal = stringLiterals[value];
+        if (literal != nullptr) {
+            return literal;
+        }
+
+        // with reference counting literal has also static block header, so it is never freed
+        size_t headerSize = arc ? 16 : 8;
+        std::string data(headerSize - sizeof(int64_t), (char) 0xff);
+        uint64_t size = value.size();
+        for (size_t i = 0; i < sizeof(int64_t); ++i) {
+            data += (char) ((size >> (i * 8)) & 0xff);
+        }
+        data += value;
+        data += '\0';
+
+        auto init = llvm::ConstantDataArray::getString(llvmContext, data, false);
+        auto gv = new llvm::GlobalVariable(*module, init->getType(), true, llvm::GlobalValue::PrivateLinkage, init,
+                                           ".str");
+        gv->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+        gv->setAlignment(llvm::MaybeAlign(8));
+
+        literal = llvm::ConstantExpr::getInBoundsGetElementPtr(init->getType(), gv,
+                                                               llvm::ArrayRef<llvm::Constant *>{
+                                                                       llvm::ConstantInt::get(intType, 0),
+                                                                       llvm::ConstantInt::get(intType, headerSize)});
+        return literal;
+    }
+
+    llvm::Constant *CodeGenContext::createStringConstant(const std::string &value, const std::string &name) {
+        auto init = llvm::ConstantDataArray::getString(llvmContext, value);
+        auto gv = new llvm::GlobalVariable(*module, init->getType(), true, llvm::GlobalValue::PrivateLinkage, init,
+                                           name);
+        gv->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+        return llvm::ConstantExpr::getPointerCast(gv, llvm::Type::getInt8PtrTy(llvmContext));
+    }
+
+    bool CodeGenContext::linkRuntime() {
+        PhaseScope phase("Link runtime");
+        auto buffer = llvm::MemoryBuffer::getFile(runtimePath);
+        if (!buffer) {
+            outs << "Build-in runtime " << runtimePath << " not found, build-in functions will not be inlined\n";
+            return false;
+        }
+
+        auto runtime = llvm::parseBitcodeFile((*buffer)->getMemBufferRef(), llvmContext);
+        if (!runtime) {
+            outs << "Build-in runtime error: " << llvm::toString(runtime.takeError()) << "\n";
+            return false;
+        }
+
+        // only used build-in functions are linked, they are internalized so optimizer can inline them
+        bool failed = llvm::Linker::linkModules(
+                *module, std::move(*runtime), llvm::Linker::LinkOnlyNeeded,
+                [](llvm::Module &linked, const llvm::StringSet<> &runtimeNames) {
+                    for (auto &name : runtimeNames) {
+                        if (auto global = linked.getNamedValue(name.getKey())) {
+                            global->setDLLStorageClass(llvm::GlobalValue::DefaultStorageClass);
+                        }
+                    }
+                    llvm::internalizeModule(linked, [&runtimeNames](const llvm::GlobalValue &global) {
+                        return !global.hasName() || runtimeNames.count(global.getName()) == 0;
+                    });
+                });
+        if (failed) {
+            outs << "Build-in runtime could not be linked\n";
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * Print llvm error to stream
+     * @return true if there was an error
+     */
+    static bool jitError(std::ostream &outs, llvm::Error err) {
+        if (err) {
+            outs << "JIT error: " << llvm::toString(std::move(err)) << "\n";
+            return true;
+        }
+        return false;
+    }
+
+    llvm::Error CodeGenContext::setUpJITSymbols(llvm::orc::LLJIT &jit) {
+        auto &dylib = jit.getMainJITDylib();
+        llvm::orc::MangleAndInterner mangle(jit.getExecutionSession(), jit.getDataLayout());
+        llvm::orc::SymbolMap symbols;
+        for (auto &info : buildins) {
+            symbols[mangle(info.name)] = llvm::JITEvaluatedSymbol(llvm::pointerToJITTargetAddress(info.addr),
+                                                                  llvm::JITSymbolFlags::Exported);
+        }
+        if (auto err = dylib.define(llvm::orc::absoluteSymbols(std::move(symbols)))) {
+            return err;
+        }
+
+        // c runtime functions (memset, ...)
+        auto processSymbols = llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+                jit.getDataLayout().getGlobalPrefix());
+        if (!processSymbols) {
+            return processSymbols.takeError();
+        }
+        dylib.addGenerator(std::move(*processSymbols));
+        return llvm::Error::success();
+    }
+
+    void CodeGenContext::runEntry(llvm::orc::LLJIT &jit, const std::string &entryName,
+                                  std::chrono::steady_clock::time_point compileStart) {
+        // entry is materialized on lookup
+        auto entry = [&]() {
+            PhaseScope phase("JIT compile");
+            return jit.lookup(entryName);
+        }();
+        if (!entry) {
+            jitError(outs, entry.takeError());
+            return;
+        }
+
+        auto runStart = std::chrono::steady_clock::now();
+        {
+            PhaseScope phase("Run");
+            auto entryFun = (void (*)()) entry->getAddress();
+            entryFun();
+        }
+        auto runEnd = std::chrono::steady_clock::now();
+
+        std::chrono::duration<double, std::milli> compileTime = runStart - compileStart;
+        std::chrono::duration<double, std::milli> runTime = runEnd - runStart;
+        outs << "\nJIT compile time: " << compileTime.count() << " ms\n";
+        outs << "Run time: " << runTime.count() << " ms\n";
+    }
+
     llvm::GenericValue CodeGenContext::runCode() {
         outs << "Running code...\n";
-        std::string err;
-        llvm::ExecutionEngine *ee = llvm::EngineBuilder(std::unique_ptr<llvm::Module>(module)).setErrorStr(
-                &err).setEngineKind(llvm::EngineKind::JIT).create();
-        std::cout << err;
-        assert(ee);
+        auto compileStart = std::chrono::steady_clock::now();
+
+        std::string entryName = getEntryFunctionName();
+        auto tsm = llvm::orc::ThreadSafeModule(std::unique_ptr<llvm::Module>(module), threadSafeContext);
+        module = nullptr;
+
+        if (objectCache != nullptr) {
+            // whole module is compiled at once, so the object can be cached
+            auto cache = objectCache;
+            auto jit = llvm::orc::LLJITBuilder()
+                    .setJITTargetMachineBuilder(createJITTargetMachineBuilder())
+                    .setNumCompileThreads(compileThreads)
+                    .setCompileFunctionCreator(
+                            [cache](llvm::orc::JITTargetMachineBuilder jtmb)
+                                    -> llvm::Expected<std::unique_ptr<llvm::orc::IRCompileLayer::IRCompiler>> {
+                                return std::make_unique<llvm::orc::ConcurrentIRCompiler>(std::move(jtmb), cache);
+                            })
+                    .create();
+            if (!jit) {
+                jitError(outs, jit.takeError());
+                return llvm::GenericValue();
+            }
+            if (jitError(outs, setUpJITSymbols(**jit)) || jitError(outs, (*jit)->addIRModule(std::move(tsm)))) {
+                return llvm::GenericValue();
+            }
+            runEntry(**jit, entryName, compileStart);
+            return llvm::GenericValue();
+        }
 
-        for (auto info : buildins) {
-            ee->addGlobalMapping(info.f, info.addr);
+        auto jit = llvm::orc::LLLazyJITBuilder()
+                .setJITTargetMachineBuilder(createJITTargetMachineBuilder())
+                .setNumCompileThreads(compileThreads)
+                .create();
+        if (!jit) {
+            jitError(outs, jit.takeError());
+            return llvm::GenericValue();
         }
+        // compile each function separately on its first call
+        (*jit)->setPartitionFunction(llvm::orc::CompileOnDemandLayer::compileRequested);
 
-        ee->finalizeObject();
-        std::vector<llvm::GenericValue> noargs;
-        llvm::GenericValue v;
-        if (mainFunction != nullptr) {
-            v = ee->runFunction(mainFunction, noargs);
-        } else {
-            v = ee->runFunction(initFunction, noargs);
+        if (jitError(outs, setUpJITSymbols(**jit)) || jitError(outs, (*jit)->addLazyIRModule(std::move(tsm)))) {
+            return llvm::GenericValue();
         }
+        runEntry(**jit, entryName, compileStart);
+        return llvm::GenericValue();
+    }
 
-        delete ee;
-        return v;
+    llvm::GenericValue CodeGenContext::runCachedCode(std::unique_ptr<llvm::MemoryBuffer> object,
+                                                     const std::string &entryName) {
+        outs << "Running cached code...\n";
+        auto compileStart = std::chrono::steady_clock::now();
+
+        if (object == nullptr) {
+            outs << "JIT error: cached object not found\n";
+            return llvm::GenericValue();
+        }
+
+        setUpBuildIns();
+        auto jit = llvm::orc::LLJITBuilder().setJITTargetMachineBuilder(createJITTargetMachineBuilder()).create();
+        if (!jit) {
+            jitError(outs, jit.takeError());
+            return llvm::GenericValue();
+        }
+        if (jitError(outs, setUpJITSymbols(**jit)) || jitError(outs, (*jit)->addObjectFile(std::move(object)))) {
+            return llvm::GenericValue();
+        }
+        runEntry(**jit, entryName, compileStart);
+        return llvm::GenericValue();
     }
 
-    void CodeGenContext::saveCode(std::ofstream& out) {
-        out << LLVMPrintModuleToString((LLVMModuleRef) module);
+    std::string CodeGenContext::getEntryFunctionName() const {
+        return (mainFunction != nullptr ? mainFunction : initFunction)->getName().str();
+    }
+
+    std::string CodeGenContext::getTargetCPU() const {
+        return targetCPU.empty() ? llvm::sys::getHostCPUName().str() : targetCPU;
+    }
+
+    std::string CodeGenContext::getTargetFeatures() const {
+        llvm::SubtargetFeatures features;
+        // features of explicitly selected cpu are implied by its name
+        llvm::StringMap<bool> hostFeatures;
+        if (targetCPU.empty() && llvm::sys::getHostCPUFeatures(hostFeatures)) {
+            for (auto &feature : hostFeatures) {
+                features.AddFeature(feature.first(), feature.second);
+            }
+        }
+        return features.getString();
+    }
+
+    llvm::CodeGenOpt::Level CodeGenContext::getCodeGenOptLevel() const {
+        switch (optLevel) {
+            case OptLevel::O0:
+                return llvm::CodeGenOpt::None;
+            case OptLevel::O1:
+                return llvm::CodeGenOpt::Less;
+            case OptLevel::O2:
+            case OptLevel::Os:
+                return llvm::CodeGenOpt::Default;
+            case OptLevel::O3:
+                return llvm::CodeGenOpt::Aggressive;
+        }
+        return llvm::CodeGenOpt::Default;
+    }
+
+    std::unique_ptr<llvm::TargetMachine> CodeGenContext::createTargetMachine() {
+        auto triple = llvm::sys::getProcessTriple();
+        std::string error;
+        auto target = llvm::TargetRegistry::lookupTarget(triple, error);
+        if (target == nullptr) {
+            outs << "Target error: " << error << "\n";
+            return nullptr;
+        }
+
+        llvm::TargetOptions options;
+        return std::unique_ptr<llvm::TargetMachine>(
+                target->createTargetMachine(triple, getTargetCPU(), getTargetFeatures(), options, llvm::Reloc::PIC_,
+                                            llvm::None, getCodeGenOptLevel()));
+    }
+
+    llvm::orc::JITTargetMachineBuilder CodeGenContext::createJITTargetMachineBuilder() {
+        llvm::orc::JITTargetMachineBuilder builder((llvm::Triple(llvm::sys::getProcessTriple())));
+        builder.setCPU(getTargetCPU());
+        builder.addFeatures(llvm::SubtargetFeatures(getTargetFeatures()).getFeatures());
+        builder.setCodeGenOptLevel(getCodeGenOptLevel());
+        return builder;
+    }
+
+    bool CodeGenContext::configureTarget() {
+        targetMachine = createTargetMachine();
+        if (targetMachine == nullptr) {
+            return false;
+        }
+
+        module->setTargetTriple(targetMachine->getTargetTriple().str());
+        module->setDataLayout(targetMachine->createDataLayout());
+
+        // optimizer and code generator query features per function
+        auto cpu = getTargetCPU();
+        auto features = getTargetFeatures();
+        for (auto &function : *module) {
+            if (!function.isDeclaration()) {
+                function.addFnAttr("target-cpu", cpu);
+                function.addFnAttr("target-features", features);
+            }
+        }
+        return true;
+    }
+
+    bool CodeGenContext::emitObject(const std::string &fileName) {
+        auto targetMachine = createTargetMachine();
+        if (targetMachine == nullptr) {
+            return false;
+        }
+        module->setTargetTriple(targetMachine->getTargetTriple().str());
+        module->setDataLayout(targetMachine->createDataLayout());
+
+        std::error_code errorCode;
+        llvm::raw_fd_ostream out(fileName, errorCode, llvm::sys::fs::OF_None);
+        if (errorCode) {
+            outs << "Could not open file " << fileName << ": " << errorCode.message() << "\n";
+            return false;
+        }
+
+        PhaseScope phase("Emit object");
+        llvm::legacy::PassManager passManager;
+        if (targetMachine->addPassesToEmitFile(passManager, out, nullptr, llvm::CGFT_ObjectFile)) {
+            outs << "Target can't emit object file\n";
+            return false;
+        }
+        passManager.run(*module);
+        out.flush();
+        return true;
+    }
+
+    bool CodeGenContext::emitObjects(const std::string &baseName, unsigned partitions,
+                                     std::vector<std::string> &objectFiles) {
+        if (partitions <= 1) {
+            objectFiles.push_back(baseName + ".o");
+            return emitObject(objectFiles.back());
+        }
+
+        auto targetMachine = createTargetMachine();
+        if (targetMachine == nullptr) {
+            return false;
+        }
+        module->setTargetTriple(targetMachine->getTargetTriple().str());
+        module->setDataLayout(targetMachine->createDataLayout());
+
+        std::vector<std::unique_ptr<llvm::raw_fd_ostream>> files;
+        std::vector<llvm::raw_pwrite_stream *> streams;
+        for (unsigned i = 0; i < partitions; i++) {
+            std::string fileName = baseName + "." + std::to_string(i) + ".o";
+            std::error_code errorCode;
+            files.push_back(std::make_unique<llvm::raw_fd_ostream>(fileName, errorCode, llvm::sys::fs::OF_None));
+            if (errorCode) {
+                outs << "Could not open file " << fileName << ": " << errorCode.message() << "\n";
+                return false;
+            }
+            streams.push_back(files.back().get());
+            objectFiles.push_back(fileName);
+        }
+
+        PhaseScope phase("Emit object");
+        // module is split to partitions, each is compiled on own thread with own llvm context
+        auto factory = [this]() { return createTargetMachine(); };
+#if LLVM_VERSION_MAJOR >= 13
+        llvm::splitCodeGen(*module, streams, {}, factory, llvm::CGFT_ObjectFile);
+#else
+        module = llvm::splitCodeGen(std::unique_ptr<llvm::Module>(module), streams, {}, factory,
+                                    llvm::CGFT_ObjectFile).release();
+#endif
+        return true;
+    }
+
+    bool CodeGenContext::saveCode(const std::string &fileName) {
+        std::error_code errorCode;
+        llvm::raw_fd_ostream out(fileName, errorCode, llvm::sys::fs::OF_Text);
+        if (errorCode) {
+            outs << "Could not open file " << fileName << ": " << errorCode.message() << "\n";
+            return false;
+        }
+
+        PhaseScope phase("Write IR");
+        module->print(out, nullptr);
+        return true;
+    }
+
+    bool CodeGenContext::saveBitcode(const std::string &fileName) {
+        std::error_code errorCode;
+        llvm::raw_fd_ostream out(fileName, errorCode, llvm::sys::fs::OF_None);
+        if (errorCode) {
+            outs << "Could not open file " << fileName << ": " << errorCode.message() << "\n";
+            return false;
+        }
+
+        PhaseScope phase("Write bitcode");
+        llvm::WriteBitcodeToFile(*module, out);
+        return true;
     }
 
     llvm::BasicBlock *CodeGenContext::getExitBlockFromCurrent() {
@@ -334,15 +1043,25 @@ namespace mlang {
     }
 
     llvm::Value *
-    CodeGenContext::createMallocCall(llvm::Type *type, int count, const std::string &name, llvm::Value *offset) {
-        return createMallocCall(type, llvm::ConstantInt::get(llvm::Type::getInt64Ty(llvmContext), count), name);
+    CodeGenContext::createMallocCall(llvm::Type *type, int count, const std::string &name, llvm::Value *offset,
+                                     const YYLTYPE *location) {
+        return createMallocCall(type, llvm::ConstantInt::get(llvm::Type::getInt64Ty(llvmContext), count), name,
+                                offset, location);
     }
 
     llvm::Value *CodeGenContext::createMallocCall(llvm::Type *type, llvm::Value *count, const std::string &name,
-                                                  llvm::Value *offset) {
-        auto fun = (module->getOrInsertFunction("__mlang_alloc",
-                                                llvm::Type::getInt8PtrTy(llvmContext),
-                                                llvm::Type::getInt64Ty(llvmContext)));
+                                                  llvm::Value *offset, const YYLTYPE *location) {
+        // allocation is counted to call site in heap profile
+        bool profiled = heapProfile && location != nullptr;
+        llvm::FunctionCallee fun;
+        if (profiled) {
+            fun = module->getOrInsertFunction("__mlang_alloc_site", llvm::Type::getInt8PtrTy(llvmContext),
+                                              llvm::Type::getInt64Ty(llvmContext),
+                                              llvm::Type::getInt8PtrTy(llvmContext));
+        } else {
+            fun = module->getOrInsertFunction("__mlang_alloc", llvm::Type::getInt8PtrTy(llvmContext),
+                                              llvm::Type::getInt64Ty(llvmContext));
+        }
 
         auto typeSize = llvm::ConstantExpr::getSizeOf(type);
         auto totalSize = llvm::BinaryOperator::Create(llvm::Instruction::Mul, typeSize, count, "malloc_size",
@@ -354,12 +1073,32 @@ namespace mlang {
 
         std::vector<llvm::Value *> fargs;
         fargs.push_back(totalSize);
+        if (profiled) {
+            fargs.push_back(getHeapSite(*location));
+        }
         auto mallocatedSpaceRaw = llvm::CallInst::Create(fun, fargs, "tmp", currentBlock());
 
         return new llvm::BitCastInst(mallocatedSpaceRaw, llvm::Type::getInt64PtrTy(llvmContext), name, currentBlock());
     }
 
+    llvm::Constant *CodeGenContext::getHeapSite(const YYLTYPE &location) {
+        // folded stack 'function;file:line'
+        std::string site = currentBlock()->getParent()->getName().str() + ";" + location.file_name + ":" +
+                           std::to_string(location.first_line);
+        auto &constant = heapSites[site];
+        if (constant == nullptr) {
+            constant = createStringConstant(site, ".heap_site");
+        }
+        return constant;
+    }
+
     void CodeGenContext::createFreeCall(llvm::Value *value) {
+        if (arc) {
+            // memory still referenced by variable cannot be freed
+            createArcCall("__mlang_drop", value);
+            return;
+        }
+
         auto fun = (module->getOrInsertFunction("__mlang_rm",
                                                 llvm::Type::getVoidTy(llvmContext),
                                                 llvm::Type::getInt8PtrTy(llvmContext)));
@@ -369,7 +1108,53 @@ namespace mlang {
         llvm::CallInst::Create(fun, fargs, "", currentBlock());
     }
 
-    bool CodeGenContext::isKeyFunction(const std::string &name) {
+    llvm::AllocaInst *CodeGenContext::createArcVariable(llvm::Type *type, const std::string &name) {
+        llvm::Function *function = currentBlock()->getParent();
+        llvm::BasicBlock &entry = function->getEntryBlock();
+        llvm::AllocaInst *variable;
+        llvm::Constant *null = llvm::Constant::getNullValue(type);
+
+        // variable declared in loop keeps one slot, so previous value can be released on next assignment
+        if (entry.empty()) {
+            variable = new llvm::AllocaInst(type, 0, name, &entry);
+            new llvm::StoreInst(null, variable, false, &entry);
+        } else {
+            llvm::Instruction *first = &entry.front();
+            variable = new llvm::AllocaInst(type, 0, name, first);
+            new llvm::StoreInst(null, variable, false, first);
+        }
+
+        arcVariables[function].push_back(variable);
+        return variable;
+    }
+
+    void CodeGenContext::createArcStore(llvm::Value *value, llvm::Value *ptr) {
+        if (!arc || !value->getType()->isPointerTy()) {
+            new llvm::StoreInst(value, ptr, false, currentBlock());
+            return;
+        }
+
+        createArcCall("__mlang_retain", value);
+        auto old = new llvm::LoadInst(value->getType(), ptr, "old", currentBlock());
+        new llvm::StoreInst(value, ptr, false, currentBlock());
+        createArcCall("__mlang_release", old);
+    }
+
+    void CodeGenContext::createArcCall(const std::string &name, llvm::Value *value) {
+        if (!arc || value == nullptr || !value->getType()->isPointerTy() || llvm::isa<llvm::Constant>(value)) {
+            return;
+        }
+
+        auto fun = module->getOrInsertFunction(name, voidType, stringType);
+        if (value->getType() != stringType) {
+            value = llvm::CastInst::CreatePointerCast(value, stringType, "cast_tmp", currentBlock());
+        }
+        std::vector<llvm::Value *> fargs;
+        fargs.push_back(value);
+        llvm::CallInst::Create(fun, fargs, "", currentBlock());
+    }
+
+    bool CodeGenContext::isReservedFunction(const std::string &name) {
         if (arrayFunctions.count(name) != 0) {
             return true;
         }
@@ -378,7 +1163,33 @@ namespace mlang {
             return true;
         }
 
-        if (name == "sizeOf") {
+        return name == "sizeOf";
+    }
+
+    bool CodeGenContext::isUserFunction(const std::string &name) {
+        auto fun = module->getFunction(name);
+        return fun != nullptr && !fun->isDeclaration();
+    }
+
+    bool CodeGenContext::isKeyFunction(const std::string &name) {
+        if (isReservedFunction(name)) {
+            return true;
+        }
+
+        // programs written before these functions were added can define their own with same name
+        if (isUserFunction(name)) {
+            return false;
+        }
+
+        if (dynamicArrayFunctions.count(name) != 0) {
+            return true;
+        }
+
+        if (fileFunctions.count(name) != 0) {
+            return true;
+        }
+
+        if (name == "len" || name == "substr" || name == "parseInts") {
             return true;
         }
 
@@ -410,6 +1221,14 @@ namespace mlang {
             return cast->codeGen(*this);
         }
 
+        if (dynamicArrayFunctions.count(name) != 0) {
+            return DynamicArray(dynamicArrayFunctions[name], args, location).codeGen(*this);
+        }
+
+        if (fileFunctions.count(name) != 0) {
+            return FileOutput(fileFunctions[name], args, location).codeGen(*this);
+        }
+
         if (name == "sizeOf") {
             if (args->size() != 1) {
                 Node::printError(location, "Invalid number of arguments");
@@ -419,6 +1238,53 @@ namespace mlang {
             return callSizeOf(args->at(0)->codeGen(*this));
         }
 
+        if (name == "len") {
+            if (args->size() != 1) {
+                Node::printError(location, "Invalid number of arguments");
+                addError();
+                return nullptr;
+            }
+            return callLen(args->at(0)->codeGen(*this), location);
+        }
+
+        if (name == "parseInts") {
+            if (args->size() != 1) {
+                Node::printError(location, "Invalid number of arguments");
+                addError();
+                return nullptr;
+            }
+
+            llvm::Value *str = args->at(0)->codeGen(*this);
+            if (str == nullptr || (str->getType() != stringType && str->getType() != sliceTypes[stringType])) {
+                Node::printError(location, "parseInts can be used only for String");
+                addError();
+                return nullptr;
+            }
+            // numbers are parsed until size of string, so slice is parsed in place
+            auto fun = module->getOrInsertFunction("__mlang_parse_ints", intArrayType, stringType, intType);
+            std::vector<llvm::Value *> fargs{getArrayPointer(str), callSizeOf(str)};
+            auto numbers = llvm::CallInst::Create(fun, fargs, "numbers", currentBlock());
+            createArcCall("__mlang_drop", str);
+            return numbers;
+        }
+
+        if (name == "substr") {
+            if (args->size() != 3) {
+                Node::printError(location, "Invalid number of arguments");
+                addError();
+                return nullptr;
+            }
+
+            llvm::Value *str = args->at(0)->codeGen(*this);
+            if (str == nullptr || (str->getType() != stringType && str->getType() != sliceTypes[stringType])) {
+                Node::printError(location, "substr can be used only for String");
+                addError();
+                return nullptr;
+            }
+            return ArraySlice::createSlice(*this, str, args->at(1)->codeGen(*this), args->at(2)->codeGen(*this),
+                                           false, location);
+        }
+
         return nullptr;
     }
 
@@ -446,20 +1312,83 @@ namespace mlang {
     }
 
     llvm::Value *CodeGenContext::callSizeOf(llvm::Value *arr) {
+        if (arr != nullptr && isSliceType(arr->getType())) {
+            return llvm::ExtractValueInst::Create(arr, {1}, "size", currentBlock());
+        }
+
         if (arr == nullptr || !arr->getType()->isPointerTy()) {
             Node::printError("sizeOf invalid parameter");
             addError();
             return nullptr;
         }
 
-        auto fun = (module->getOrInsertFunction("sizeOf",
-                                                llvm::Type::getInt64Ty(llvmContext),
-                                                llvm::Type::getInt64PtrTy(llvmContext)));
-        std::vector<llvm::Value *> fargs;
+        // size is stored before items, it is loaded inline (same as build in sizeOf) so bounds checks are not calls
+        llvm::Function *function = currentBlock()->getParent();
+        auto errBlock = llvm::BasicBlock::Create(llvmContext, "size_err", function);
+        auto sizeBlock = llvm::BasicBlock::Create(llvmContext, "size_of", function);
+
         arr = llvm::CastInst::CreatePointerCast(arr, llvm::Type::getInt64PtrTy(llvmContext), "cast_tmp", currentBlock());
-        fargs.push_back(arr);
-        llvm::Value *size = llvm::CallInst::Create(fun, fargs, "size_of", currentBlock());
-        return new llvm::BitCastInst(size, llvm::Type::getInt64Ty(llvmContext), "size", currentBlock());
+        auto isNull = new llvm::ICmpInst(*currentBlock(), llvm::CmpInst::ICMP_EQ, arr,
+                                         llvm::Constant::getNullValue(arr->getType()), "is_null");
+        llvm::BranchInst::Create(errBlock, sizeBlock, isNull, currentBlock());
+
+        setInsertPoint(errBlock);
+        runtimeError(RuntimeError::INVALID_SIZEOF_USAGE);
+        llvm::BranchInst::Create(sizeBlock, currentBlock());
+
+        setInsertPoint(sizeBlock);
+        llvm::Value *indices[1] = {llvm::ConstantInt::get(intType, -1)};
+        auto sizePtr = llvm::GetElementPtrInst::CreateInBounds(intType, arr, indices, "size_ptr", currentBlock());
+        return new llvm::LoadInst(intType, sizePtr, "size", currentBlock());
+    }
+
+    llvm::Value *CodeGenContext::callLen(llvm::Value *str, const YYLTYPE &location) {
+        if (str == nullptr || (str->getType() != stringType && str->getType() != sliceTypes[stringType])) {
+            Node::printError(location, "Invalid parameter type");
+            addError();
+            return nullptr;
+        }
+
+        llvm::Value *length = getStringLength(str);
+        if (!isSliceType(str->getType())) {
+            createArcCall("__mlang_drop", str);
+        }
+        return length;
+    }
+
+    llvm::Value *CodeGenContext::getStringLength(llvm::Value *str) {
+        // string ends with null or at its size (slice, full String)
+        auto size = callSizeOf(str);
+        auto fun = module->getOrInsertFunction("strnlen", intType, stringType, intType);
+        std::vector<llvm::Value *> fargs{getArrayPointer(str), size};
+        return llvm::CallInst::Create(fun, fargs, "len", currentBlock());
+    }
+
+    bool CodeGenContext::isSliceType(llvm::Type *type) {
+        for (auto &slice : sliceTypes) {
+            if (slice.second == type) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    llvm::StructType *CodeGenContext::getSliceType(llvm::Type *arrayType) {
+        auto slice = sliceTypes.find(arrayType);
+        return slice != sliceTypes.end() ? slice->second : nullptr;
+    }
+
+    llvm::Value *CodeGenContext::createSlice(llvm::Value *ptr, llvm::Value *size) {
+        llvm::Value *slice = llvm::UndefValue::get(getSliceType(ptr->getType()));
+        slice = llvm::InsertValueInst::Create(slice, ptr, {0}, "slice", currentBlock());
+        return llvm::InsertValueInst::Create(slice, size, {1}, "slice", currentBlock());
+    }
+
+    llvm::Value *CodeGenContext::getArrayPointer(llvm::Value *array) {
+        if (isSliceType(array->getType())) {
+            return llvm::ExtractValueInst::Create(array, {0}, "slice_ptr", currentBlock());
+        }
+        return array;
     }
 
     llvm::Type *Variable::getType() {
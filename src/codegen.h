@@ -7,7 +7,9 @@
 #ifndef MLANG_CODEGEN_H
 #define MLANG_CODEGEN_H
 
+#include <chrono>
 #include <list>
+#include <map>
 #include <utility>
 
 #pragma warning(push, 0)
@@ -16,10 +18,12 @@
 #include <llvm/IR/Constants.h>
 #include <llvm/IR/Instructions.h>
 #include <llvm/IR/Module.h>
-#include <llvm/IR/LegacyPassManager.h>
-#include <llvm/Transforms/IPO/PassManagerBuilder.h>
 #include <llvm/ExecutionEngine/GenericValue.h>
-#include <llvm/ExecutionEngine/ExecutionEngine.h>
+#include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/ObjectCache.h>
+#include <llvm/Target/TargetMachine.h>
+#include <llvm/Support/Host.h>
 #include <llvm/Support/ManagedStatic.h>
 #include <llvm/Support/TargetSelect.h>
 #include <llvm/IR/IRBuilder.h>
@@ -29,7 +33,9 @@
 #include "buildins.h"
 #include "ast.h"
 #include "array.h"
+#include "fileio.h"
 #include "cast.h"
+#include "arc.h"
 
 namespace mlang {
 
@@ -42,6 +48,17 @@ namespace mlang {
         GLOBAL_BLOCK // code block outside functions
     };
 
+    /**
+     * Code optimization level
+     */
+    enum class OptLevel {
+        O0, // optimizer disabled
+        O1,
+        O2,
+        O3,
+        Os // optimize for size
+    };
+
     /**
      * Variable scope
      */
@@ -128,9 +145,12 @@ namespace mlang {
      */
     class CodeGenContext {
     public:
-        explicit CodeGenContext(std::ostream &outs, bool debug, bool run);
+        explicit CodeGenContext(std::ostream &outs, bool debug, bool run, OptLevel optLevel = OptLevel::O3);
 
-        ~CodeGenContext() { llvm::llvm_shutdown(); }
+        ~CodeGenContext() {
+            targetMachine.reset();
+            llvm::llvm_shutdown();
+        }
 
         /**
          * Return llvm context
@@ -218,6 +238,7 @@ namespace mlang {
 
         /**
          * Run IR code optimalization
+         * (whole module pipeline for selected optimization level)
          */
         void optimize();
 
@@ -227,14 +248,137 @@ namespace mlang {
         bool generateCode(class Block &root);
 
         /**
-         * Run code using JIT compiler
+         * Run code using lazy ORC JIT compiler
+         * only entry function is compiled on startup, others on their first call
          */
         llvm::GenericValue runCode();
 
         /**
-         * Save IR code to stream
+         * Run object loaded from JIT cache, code is not generated at all
+         */
+        llvm::GenericValue runCachedCode(std::unique_ptr<llvm::MemoryBuffer> object, const std::string &entryName);
+
+        /**
+         * Set cache for JIT compiled objects
+         * if set, whole module is compiled at once (not lazily)
+         */
+        void setObjectCache(llvm::ObjectCache *cache) { objectCache = cache; }
+
+        /**
+         * Set target cpu (e.g. skylake, generic), features are implied by cpu
+         * if not set, host cpu and all its features are used
+         */
+        void setTargetCPU(std::string cpu) { targetCPU = std::move(cpu); }
+
+        /**
+         * Get name of target cpu
+         */
+        std::string getTargetCPU() const;
+
+        /**
+         * Instrument code, profile is written to file when program exits
+         */
+        void setProfileGenerate(std::string fileName) { profileGenerate = std::move(fileName); }
+
+        /**
+         * Optimize code using profile (.profdata) from instrumented run
+         */
+        void setProfileUse(std::string fileName) { profileUse = std::move(fileName); }
+
+        /**
+         * Count allocations per source line, report is printed when program ends
+         * @param foldedFile file for flamegraph compatible report
+         */
+        void setHeapProfile(std::string foldedFile) {
+            heapProfile = true;
+            heapProfileFile = std::move(foldedFile);
+        }
+
+        /**
+         * Set size in bytes from which arrays are mapped directly from os (aligned to huge pages)
+         */
+        void setHugeThreshold(int64_t size) { hugeThreshold = size; }
+
+        /**
+         * Set when output of print and println is flushed (size in bytes is used by FlushMode::SIZE)
+         */
+        void setFlushMode(FlushMode mode, int64_t size = 0) {
+            flushMode = mode;
+            flushSize = size;
+        }
+
+        /**
+         * Manage memory of arrays and strings by reference counting, rm only frees unreferenced memory
+         */
+        void setArc(bool enabled) { arc = enabled; }
+
+        /**
+         * Check if reference counting is enabled
+         */
+        bool isArc() const { return arc; }
+
+        /**
+         * Create local variable for array or string (--arc)
+         * variable is null initialized in function entry and released when function returns
+         */
+        llvm::AllocaInst *createArcVariable(llvm::Type *type, const std::string &name);
+
+        /**
+         * Store value to variable, array or string is retained and previous value released (--arc)
+         */
+        void createArcStore(llvm::Value *value, llvm::Value *ptr);
+
+        /**
+         * Call reference counting function (__mlang_retain, __mlang_release, __mlang_unretain, __mlang_drop)
+         * nothing is generated without --arc or for constants (string literals)
+         */
+        void createArcCall(const std::string &name, llvm::Value *value);
+
+        /**
+         * Set number of threads used by JIT to compile functions (0 = compile on calling thread)
+         */
+        void setCompileThreads(unsigned threads) { compileThreads = threads; }
+
+        /**
+         * Set path to build-in runtime bitcode (buildins.bc)
+         * if set, runtime is linked into compiled module before optimization (jit uses build-ins of compiler)
+         */
+        void setRuntimePath(std::string path) { runtimePath = std::move(path); }
+
+        /**
+         * Check if build-in runtime was linked into module
+         */
+        bool isRuntimeLinked() const { return runtimeLinked; }
+
+        /**
+         * Get name of function called on start (main or init function)
+         */
+        std::string getEntryFunctionName() const;
+
+        /**
+         * Compile module to native object file (for host target)
+         * @return true on success
+         */
+        bool emitObject(const std::string &fileName);
+
+        /**
+         * Compile module to native object files, module is split to partitions compiled in parallel
+         * @param objectFiles names of generated object files
+         * @return true on success
+         */
+        bool emitObjects(const std::string &baseName, unsigned partitions, std::vector<std::string> &objectFiles);
+
+        /**
+         * Save IR code to file (streamed, module is not printed to memory first)
+         * @return true on success
+         */
+        bool saveCode(const std::string &fileName);
+
+        /**
+         * Save module as LLVM bitcode to file
+         * @return true on success
          */
-        void saveCode(std::ofstream& out);
+        bool saveBitcode(const std::string &fileName);
 
         /**
          * Setup build in functions
@@ -252,11 +396,17 @@ namespace mlang {
          */
         static bool isBreakingInstruction(llvm::Value *value);
 
+        /**
+         * Create allocation call
+         * @param location source location of allocation, used as call site in heap profile
+         */
         llvm::Value *
-        createMallocCall(llvm::Type *type, int count, const std::string &name, llvm::Value *offset = nullptr);
+        createMallocCall(llvm::Type *type, int count, const std::string &name, llvm::Value *offset = nullptr,
+                         const YYLTYPE *location = nullptr);
 
         llvm::Value *
-        createMallocCall(llvm::Type *type, llvm::Value *count, const std::string &name, llvm::Value *offset = nullptr);
+        createMallocCall(llvm::Type *type, llvm::Value *count, const std::string &name, llvm::Value *offset = nullptr,
+                         const YYLTYPE *location = nullptr);
 
         /**
          * Clear memory
@@ -264,10 +414,45 @@ namespace mlang {
         void clearMemory(llvm::Value *ptr, llvm::Value *size);
 
         /**
-         * Call sizeOf build in function
+         * Get String of literal, every distinct literal is emitted once (size header, characters and null)
+         */
+        llvm::Constant *getStringLiteral(const std::string &value);
+
+        /**
+         * Get size of array or slice (same as sizeOf build in function, but inline)
          */
         llvm::Value *callSizeOf(llvm::Value *arr);
 
+        /**
+         * Get length of String or String slice (len build in function), temporary String is dropped
+         */
+        llvm::Value *callLen(llvm::Value *str, const YYLTYPE &location);
+
+        /**
+         * Get length of String or String slice, characters until null or its size
+         */
+        llvm::Value *getStringLength(llvm::Value *str);
+
+        /**
+         * Check if type is slice (view to part of array or string)
+         */
+        bool isSliceType(llvm::Type *type);
+
+        /**
+         * Get slice type for array type, nullptr if there is none
+         */
+        llvm::StructType *getSliceType(llvm::Type *arrayType);
+
+        /**
+         * Create slice from pointer to its first item and size
+         */
+        llvm::Value *createSlice(llvm::Value *ptr, llvm::Value *size);
+
+        /**
+         * Get pointer to first item of array or slice
+         */
+        llvm::Value *getArrayPointer(llvm::Value *array);
+
         /**
          * Create free call
          */
@@ -275,9 +460,20 @@ namespace mlang {
 
         /**
          * Check if fun is 'key' function = internal build in function
+         * program's own function with same name takes precedence, except reserved functions
          */
         bool isKeyFunction(const std::string &name);
 
+        /**
+         * Check if name is reserved for key function (array constructors, casts, sizeOf) and cannot be used by program
+         */
+        bool isReservedFunction(const std::string &name);
+
+        /**
+         * Check if function is defined by program (not build in)
+         */
+        bool isUserFunction(const std::string &name);
+
         /**
          * Call 'key' function (internal build in function)
          */
@@ -294,19 +490,103 @@ namespace mlang {
          */
         void setCurrentBlock(llvm::BasicBlock *block) { codeBlocks.front()->setCodeBlock(block); }
 
+        /**
+         * Get target features (host features if target cpu is not set)
+         */
+        std::string getTargetFeatures() const;
+
+        llvm::CodeGenOpt::Level getCodeGenOptLevel() const;
+
+        /**
+         * Create target machine for host target, target cpu and current optimization level
+         */
+        std::unique_ptr<llvm::TargetMachine> createTargetMachine();
+
+        /**
+         * Create JIT target machine builder for host target, target cpu and current optimization level
+         */
+        llvm::orc::JITTargetMachineBuilder createJITTargetMachineBuilder();
+
+        /**
+         * Set target triple, data layout and cpu features to module before it is optimized
+         * @return true on success
+         */
+        bool configureTarget();
+
+        /**
+         * Call heap report before entry function returns
+         */
+        void addHeapReport();
+
+        /**
+         * Set huge array threshold of runtime when entry function starts
+         */
+        void addHugeThreshold();
+
+        /**
+         * Set output flush mode when entry function starts and flush output before it returns
+         */
+        void addOutputFlush();
+
+        /**
+         * Get constant string with heap profile call site of location
+         */
+        llvm::Constant *getHeapSite(const YYLTYPE &location);
+
+        /**
+         * Create private constant null terminated string
+         */
+        llvm::Constant *createStringConstant(const std::string &value, const std::string &name);
+
+        /**
+         * Link used build-in functions from runtime bitcode and internalize them
+         * @return true on success
+         */
+        bool linkRuntime();
+
+        /**
+         * Define build in functions and process symbols in JIT
+         */
+        llvm::Error setUpJITSymbols(llvm::orc::LLJIT &jit);
+
+        /**
+         * Lookup entry function in JIT and run it
+         */
+        void runEntry(llvm::orc::LLJIT &jit, const std::string &entryName,
+                      std::chrono::steady_clock::time_point compileStart);
+
         bool debug {false};
         bool run {false};
+        OptLevel optLevel{OptLevel::O3};
         std::list<CodeGenBlock *> codeBlocks;
         llvm::Function *initFunction{nullptr};
         llvm::Function *mainFunction{nullptr};
         llvm::Module *module{nullptr};
-        llvm::LLVMContext llvmContext;
+        llvm::ObjectCache *objectCache{nullptr};
+        std::string runtimePath;
+        bool runtimeLinked{false};
+        unsigned compileThreads{0};
+        std::string profileGenerate;
+        std::string profileUse;
+        std::string targetCPU;
+        bool heapProfile{false};
+        std::string heapProfileFile;
+        std::map<std::string, llvm::Constant *> heapSites;
+        int64_t hugeThreshold{-1};
+        FlushMode flushMode{FlushMode::AUTO};
+        int64_t flushSize{0};
+        bool arc{false};
+        ArcVariables arcVariables;
+        std::unique_ptr<llvm::TargetMachine> targetMachine;
+        llvm::orc::ThreadSafeContext threadSafeContext;
+        llvm::LLVMContext &llvmContext;
         ScopeType scopeType{ScopeType::CODE_BLOCK};
         std::ostream &outs;
         int errors{0};
 
+        // function name is kept, declaration can be removed by optimizer
         struct buildin_info_t {
-            llvm::Function *f{nullptr};
+            std::string name;
             void *addr{nullptr};
         };
         std::vector<buildin_info_t> buildins;
@@ -324,6 +604,10 @@ namespace mlang {
         std::map<std::string, llvm::Type *> llvmTypeMap;
         std::map<std::string, llvm::Type *> arrayFunctions;
         std::map<std::string, llvm::Type *> castFunctions;
+        std::map<std::string, DynamicArray::Operation> dynamicArrayFunctions;
+        std::map<std::string, FileOutput::Operation> fileFunctions;
+        std::map<llvm::Type *, llvm::StructType *> sliceTypes;
+        std::map<std::string, llvm::Constant *> stringLiterals;
     };
 }
 
@@ -20,7 +20,9 @@ namespace mlang {
             return nullptr;
         }
 
-        if (rhsVal->getType() != lhsVal->getType()) {
+        bool isStringTy = isString(lhsVal, context) && isString(rhsVal, context);
+
+        if (rhsVal->getType() != lhsVal->getType() && !isStringTy) {
             Node::printError(location, "Comparison of incompatible types");
             context.addError();
             return nullptr;
@@ -30,7 +32,6 @@ namespace mlang {
         bool isIntTy = rhsVal->getType()->isIntegerTy(64);
         bool isCharTy = rhsVal->getType()->isIntegerTy(8);
         bool isBoolTy = rhsVal->getType()->isIntegerTy(1);
-        bool isStringTy = rhsVal->getType() == llvm::Type::getInt8PtrTy(context.getGlobalContext());
 
         llvm::Value *val = nullptr;
         if (isDoubleTy) {
@@ -134,13 +135,29 @@ namespace mlang {
                                      context.currentBlock());
     }
 
+    bool Comparison::isString(llvm::Value *value, CodeGenContext &context) {
+        auto stringType = llvm::Type::getInt8PtrTy(context.getGlobalContext());
+        return value->getType() == stringType || value->getType() == context.getSliceType(stringType);
+    }
+
     llvm::Value *Comparison::stringCodeGen(llvm::Value *lhsValue, llvm::Value *rhsValue, CodeGenContext &context) const {
         auto intType = llvm::Type::getInt64Ty(context.getGlobalContext());
         auto ptrType = llvm::Type::getInt8PtrTy(context.getGlobalContext());
-        llvm::FunctionCallee fun = (context.getModule()->getOrInsertFunction("__mlang_scompare", intType, ptrType, ptrType));
+        llvm::FunctionCallee fun;
         std::vector<llvm::Value *> fargs;
-        fargs.push_back(lhsValue);
-        fargs.push_back(rhsValue);
+        if (context.isSliceType(lhsValue->getType()) || context.isSliceType(rhsValue->getType())) {
+            // slice has its size aside of data
+            fun = context.getModule()->getOrInsertFunction("__mlang_scompare_n", intType, ptrType, intType, ptrType,
+                                                           intType);
+            fargs.push_back(context.getArrayPointer(lhsValue));
+            fargs.push_back(context.callSizeOf(lhsValue));
+            fargs.push_back(context.getArrayPointer(rhsValue));
+            fargs.push_back(context.callSizeOf(rhsValue));
+        } else {
+            fun = context.getModule()->getOrInsertFunction("__mlang_scompare", intType, ptrType, ptrType);
+            fargs.push_back(lhsValue);
+            fargs.push_back(rhsValue);
+        }
 
         llvm::Value *result = llvm::CallInst::Create(fun, fargs, "compare", context.currentBlock());
         llvm::Value *val;
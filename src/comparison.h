@@ -41,6 +41,11 @@ namespace mlang {
 
         llvm::Value *stringCodeGen(llvm::Value *lhsValue, llvm::Value *rhsValue, CodeGenContext &context) const;
 
+        /**
+         * Check if value is String or String slice
+         */
+        static bool isString(llvm::Value *value, CodeGenContext &context);
+
     private:
         int op{0};
         Expression *lhs{nullptr};
@@ -0,0 +1,265 @@
+/**
+ * Created by agent on 18.10.2026.
+ * agent@local
+ *
+ * Author: agent
+ */
+#include "escape.h"
+
+#include <set>
+#include <string>
+
+#pragma warning(push, 0)
+
+#include <llvm/Analysis/ConstantFolding.h>
+#include <llvm/IR/Dominators.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/Transforms/Utils/BasicBlockUtils.h>
+#include <llvm/Transforms/Utils/PromoteMemToReg.h>
+
+#pragma warning(pop)
+
+namespace mlang {
+
+    void EscapeAnalysis::run() {
+        for (auto &function : module) {
+            if (!function.isDeclaration()) {
+                runOnFunction(function);
+            }
+        }
+    }
+
+    void EscapeAnalysis::runOnFunction(llvm::Function &function) {
+        // variables must be in registers, so array pointer is not hidden behind its variable,
+        // variables declared in loop or if branch are moved to entry block (they are initialized by declaration)
+        llvm::DominatorTree dominatorTree(function);
+        auto &entry = function.getEntryBlock();
+        std::vector<llvm::AllocaInst *> variables;
+        for (auto &block : function) {
+            for (auto &inst : llvm::make_early_inc_range(block)) {
+                auto alloca = llvm::dyn_cast<llvm::AllocaInst>(&inst);
+                if (alloca == nullptr || alloca->isArrayAllocation()) {
+                    continue;
+                }
+                if (&block != &entry) {
+                    alloca->moveBefore(&*entry.getFirstInsertionPt());
+                }
+                if (llvm::isAllocaPromotable(alloca)) {
+                    variables.push_back(alloca);
+                }
+            }
+        }
+        if (!variables.empty()) {
+            llvm::PromoteMemToReg(variables, dominatorTree);
+        }
+
+        std::vector<llvm::CallInst *> allocs;
+        for (auto &block : function) {
+            for (auto &inst : block) {
+                if (auto call = llvm::dyn_cast<llvm::CallInst>(&inst)) {
+                    auto callee = call->getCalledFunction();
+                    if (callee != nullptr &&
+                        (callee->getName() == "__mlang_alloc" || callee->getName() == "__mlang_alloc_site")) {
+                        allocs.push_back(call);
+                    }
+                }
+            }
+        }
+
+        for (auto alloc : allocs) {
+            std::vector<llvm::CallInst *> frees;
+            if (escapes(alloc, frees)) {
+                continue;
+            }
+
+            auto size = getConstantSize(alloc->getArgOperand(0));
+            if (size != nullptr && size->getSExtValue() <= MAX_STACK_ARRAY_SIZE) {
+                moveToStack(alloc, size->getSExtValue(), frees);
+            } else if (freeArrays && frees.empty()) {
+                freeOnScopeExit(alloc, dominatorTree);
+            }
+        }
+    }
+
+    llvm::ConstantInt *EscapeAnalysis::getConstantSize(llvm::Value *size) const {
+        if (auto constant = llvm::dyn_cast<llvm::Constant>(size)) {
+            return llvm::dyn_cast<llvm::ConstantInt>(llvm::ConstantFoldConstant(constant, module.getDataLayout()));
+        }
+
+        auto op = llvm::dyn_cast<llvm::BinaryOperator>(size);
+        if (op == nullptr) {
+            return nullptr;
+        }
+        auto lhs = getConstantSize(op->getOperand(0));
+        auto rhs = getConstantSize(op->getOperand(1));
+        if (lhs == nullptr || rhs == nullptr) {
+            return nullptr;
+        }
+        return llvm::dyn_cast_or_null<llvm::ConstantInt>(
+                llvm::ConstantFoldBinaryOpOperands(op->getOpcode(), lhs, rhs, module.getDataLayout()));
+    }
+
+    bool EscapeAnalysis::escapes(llvm::CallInst *alloc, std::vector<llvm::CallInst *> &frees) {
+        std::vector<llvm::Value *> worklist{alloc};
+        std::set<llvm::Value *> visited{alloc};
+
+        while (!worklist.empty()) {
+            auto value = worklist.back();
+            worklist.pop_back();
+
+            for (auto user : value->users()) {
+                // pointer converted to int is followed too, String is passed to __mlang_cast as Int
+                if (llvm::isa<llvm::BitCastInst>(user) || llvm::isa<llvm::GetElementPtrInst>(user) ||
+                    llvm::isa<llvm::PtrToIntInst>(user)) {
+                    if (visited.insert(user).second) {
+                        worklist.push_back(user);
+                    }
+                } else if (llvm::isa<llvm::LoadInst>(user) || llvm::isa<llvm::ICmpInst>(user)) {
+                    continue;
+                } else if (auto phi = llvm::dyn_cast<llvm::PHINode>(user)) {
+                    if (!isReleasedOnly(phi)) {
+                        return true;
+                    }
+                } else if (auto store = llvm::dyn_cast<llvm::StoreInst>(user)) {
+                    // storing into array is fine, storing array pointer anywhere is not
+                    if (store->getValueOperand() == value) {
+                        return true;
+                    }
+                } else if (auto call = llvm::dyn_cast<llvm::CallInst>(user)) {
+                    auto callee = call->getCalledFunction();
+                    if (callee != nullptr && callee->getName() == "__mlang_rm") {
+                        frees.push_back(call);
+                    } else if (isCapturingCall(call)) {
+                        return true;
+                    }
+                } else {
+                    // returned, merged in phi/select, converted to int, ...
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+
+    bool EscapeAnalysis::isReleasedOnly(llvm::PHINode *phi) {
+        // --arc variable declared in loop keeps previous value to release it on next assignment,
+        // stack array has static header, so its release does nothing
+        static const std::set<std::string> arcFunctions{
+                "__mlang_retain", "__mlang_release", "__mlang_unretain", "__mlang_drop"
+        };
+
+        std::vector<llvm::PHINode *> worklist{phi};
+        std::set<llvm::PHINode *> visited{phi};
+
+        while (!worklist.empty()) {
+            auto value = worklist.back();
+            worklist.pop_back();
+
+            for (auto user : value->users()) {
+                if (auto next = llvm::dyn_cast<llvm::PHINode>(user)) {
+                    if (visited.insert(next).second) {
+                        worklist.push_back(next);
+                    }
+                    continue;
+                }
+                auto call = llvm::dyn_cast<llvm::CallInst>(user);
+                auto callee = call != nullptr ? call->getCalledFunction() : nullptr;
+                if (callee == nullptr || arcFunctions.count(callee->getName().str()) == 0) {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    bool EscapeAnalysis::isCapturingCall(llvm::CallInst *call) {
+        static const std::set<std::string> nonCapturing{
+                "print", "println", "sizeOf", "len", "strnlen", "__mlang_scompare", "__mlang_copy", "memset",
+                "__mlang_write", "__mlang_write_string", "__mlang_len", "__mlang_scompare_n",
+                "readFile", "__mlang_open_write", "__mlang_file_write", "__mlang_file_write_line",
+                "__mlang_file_write_array", "__mlang_parse_ints", "__mlang_cast", "__mlang_castd",
+                "__mlang_retain", "__mlang_release", "__mlang_unretain", "__mlang_drop"
+        };
+
+        auto callee = call->getCalledFunction();
+        return callee == nullptr || !callee->isDeclaration() || nonCapturing.count(callee->getName().str()) == 0;
+    }
+
+    void EscapeAnalysis::moveToStack(llvm::CallInst *alloc, int64_t size, std::vector<llvm::CallInst *> &frees) {
+        auto &context = module.getContext();
+        auto &entry = alloc->getFunction()->getEntryBlock();
+
+        // array has static block header (like string literal), so reference counting never frees it
+        llvm::IRBuilder<> entryBuilder(&entry, entry.getFirstInsertionPt());
+        auto memory = entryBuilder.CreateAlloca(
+                llvm::ArrayType::get(llvm::Type::getInt8Ty(context), BLOCK_HEADER_SIZE + size), nullptr, "stack_array");
+        memory->setAlignment(llvm::Align(16));
+        auto header = entryBuilder.CreatePointerCast(memory, llvm::Type::getInt64PtrTy(context));
+        entryBuilder.CreateStore(entryBuilder.getInt64(-1), header);
+
+        // array is zeroed every time its allocation is reached, like memory from __mlang_alloc
+        llvm::IRBuilder<> builder(alloc);
+        auto ptr = builder.CreateConstInBoundsGEP2_64(memory->getAllocatedType(), memory, 0, BLOCK_HEADER_SIZE);
+        builder.CreateMemSet(ptr, builder.getInt8(0), size, llvm::MaybeAlign(8));
+        ptr = builder.CreatePointerCast(ptr, alloc->getType());
+
+        alloc->replaceAllUsesWith(ptr);
+        alloc->eraseFromParent();
+        for (auto free : frees) {
+            free->eraseFromParent();
+        }
+    }
+
+    void EscapeAnalysis::freeOnScopeExit(llvm::CallInst *alloc, llvm::DominatorTree &dominatorTree) {
+        auto &context = module.getContext();
+        auto fun = module.getOrInsertFunction("__mlang_rm", llvm::Type::getVoidTy(context),
+                                              llvm::Type::getInt8PtrTy(context));
+
+        // array is used only in blocks dominated by its allocation (merging it in phi escapes), so its scope
+        // is left by return or by edge to block outside of them (end of if branch, loop exit or loop back edge)
+        auto scope = alloc->getParent();
+        std::vector<llvm::Instruction *> exits;
+        std::vector<std::pair<llvm::BasicBlock *, unsigned>> edges;
+        for (auto &block : *alloc->getFunction()) {
+            if (!dominatorTree.isReachableFromEntry(&block) || !dominatorTree.dominates(scope, &block)) {
+                continue;
+            }
+            auto terminator = block.getTerminator();
+            if (llvm::isa<llvm::ReturnInst>(terminator)) {
+                exits.push_back(terminator);
+                continue;
+            }
+            for (unsigned i = 0; i < terminator->getNumSuccessors(); i++) {
+                auto successor = terminator->getSuccessor(i);
+                if (successor == scope || !dominatorTree.dominates(scope, successor)) {
+                    edges.emplace_back(&block, i);
+                }
+            }
+        }
+
+        for (auto &edge : edges) {
+            auto terminator = edge.first->getTerminator();
+            auto successor = terminator->getSuccessor(edge.second);
+            if (terminator->getNumSuccessors() == 1) {
+                exits.push_back(terminator);
+            } else if (successor != scope && successor->getSinglePredecessor() != nullptr) {
+                exits.push_back(&*successor->getFirstInsertionPt());
+            } else {
+                // condition of loop or if also continues in scope, free is on new block of exit edge
+                auto split = llvm::SplitCriticalEdge(terminator, edge.second,
+                                                     llvm::CriticalEdgeSplittingOptions(&dominatorTree));
+                exits.push_back(split->getTerminator());
+            }
+        }
+
+        for (auto exit : exits) {
+            // __mlang_rm expects pointer after array size
+            llvm::IRBuilder<> builder(exit);
+            auto data = builder.CreateConstGEP1_64(llvm::Type::getInt8Ty(context), alloc, sizeof(int64_t));
+            builder.CreateCall(fun, {data});
+        }
+    }
+
+}
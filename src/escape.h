@@ -0,0 +1,85 @@
+/**
+ * Created by agent on 18.10.2026.
+ * agent@local
+ *
+ * Author: agent
+ */
+#ifndef MLANG_ESCAPE_H
+#define MLANG_ESCAPE_H
+
+#include <vector>
+
+#pragma warning(push, 0)
+
+#include <llvm/IR/Dominators.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Instructions.h>
+
+#pragma warning(pop)
+
+namespace mlang {
+
+    /**
+     * Escape analysis of arrays and strings allocated by __mlang_alloc (or __mlang_alloc_site with heap profile)
+     * array which is not returned, not stored to memory (global, other array) and not passed to unknown function
+     * is moved to stack if its size is small constant, otherwise it is freed when its scope (function, loop body, if branch) ends
+     * (only when arrays are not freed by reference counting)
+     */
+    class EscapeAnalysis {
+    public:
+        /**
+         * Max size (in bytes, including size header) of array allocated on stack
+         */
+        static constexpr int64_t MAX_STACK_ARRAY_SIZE = 1024;
+
+        /**
+         * Size of runtime block header (size class and reference count) before array
+         */
+        static constexpr int64_t BLOCK_HEADER_SIZE = 8;
+
+        /**
+         * @param freeArrays insert free of non escaping arrays which cannot be moved to stack
+         */
+        EscapeAnalysis(llvm::Module &module, bool freeArrays) : module(module), freeArrays(freeArrays) {}
+
+        /**
+         * Run analysis and transform allocations in all functions
+         */
+        void run();
+
+    private:
+        void runOnFunction(llvm::Function &function);
+
+        /**
+         * Check if allocated memory escapes
+         * @param frees calls of __mlang_rm with this memory
+         */
+        static bool escapes(llvm::CallInst *alloc, std::vector<llvm::CallInst *> &frees);
+
+        /**
+         * Check if memory passed to build in function can escape
+         */
+        static bool isCapturingCall(llvm::CallInst *call);
+
+        /**
+         * Check if value merged in phi is only passed to reference counting functions
+         */
+        static bool isReleasedOnly(llvm::PHINode *phi);
+
+        /**
+         * Fold allocation size computed from type size (sizeof * count + header)
+         * @return nullptr if size is not constant
+         */
+        llvm::ConstantInt *getConstantSize(llvm::Value *size) const;
+
+        void moveToStack(llvm::CallInst *alloc, int64_t size, std::vector<llvm::CallInst *> &frees);
+
+        void freeOnScopeExit(llvm::CallInst *alloc, llvm::DominatorTree &dominatorTree);
+
+        llvm::Module &module;
+        bool freeArrays;
+    };
+
+}
+
+#endif /* MLANG_ESCAPE_H */
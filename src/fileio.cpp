@@ -0,0 +1,142 @@
+/**
+ * Created by agent on 18.10.2026.
+ * agent@local
+ *
+ * Author: agent
+ */
+#include "fileio.h"
+#include "codegen.h"
+#include "function.h"
+
+namespace mlang {
+
+    llvm::Value *FileOutput::codeGen(CodeGenContext &context) {
+        size_t argsCount = operation == Operation::OPEN || operation == Operation::CLOSE ? 1 : 2;
+        if (args->size() < argsCount || (operation != Operation::WRITE && operation != Operation::WRITE_LINE &&
+                                         args->size() != argsCount)) {
+            Node::printError(location, "Invalid number of arguments");
+            context.addError();
+            return nullptr;
+        }
+
+        auto stringType = llvm::Type::getInt8PtrTy(context.getGlobalContext());
+        auto intType = llvm::Type::getInt64Ty(context.getGlobalContext());
+        auto voidType = llvm::Type::getVoidTy(context.getGlobalContext());
+
+        if (operation == Operation::OPEN) {
+            llvm::Value *path = args->at(0)->codeGen(context);
+            if (path == nullptr || path->getType() != stringType) {
+                Node::printError(location, "File path must be String");
+                context.addError();
+                return nullptr;
+            }
+
+            auto fun = context.getModule()->getOrInsertFunction("__mlang_open_write", intType, stringType);
+            std::vector<llvm::Value *> fargs{path};
+            auto file = llvm::CallInst::Create(fun, fargs, "file", context.currentBlock());
+            dropTemporary(context, args->at(0), path);
+            return file;
+        }
+
+        llvm::Value *handle = handleCodeGen(context);
+        if (handle == nullptr) {
+            return nullptr;
+        }
+
+        switch (operation) {
+            case Operation::WRITE:
+            case Operation::WRITE_LINE:
+                return writeCodeGen(context, handle);
+            case Operation::WRITE_ARRAY:
+                return writeArrayCodeGen(context, handle);
+            case Operation::CLOSE: {
+                auto fun = context.getModule()->getOrInsertFunction("__mlang_file_close", voidType, intType);
+                std::vector<llvm::Value *> fargs{handle};
+                return llvm::CallInst::Create(fun, fargs, "", context.currentBlock());
+            }
+            default:
+                return nullptr;
+        }
+    }
+
+    llvm::Value *FileOutput::handleCodeGen(CodeGenContext &context) {
+        llvm::Value *handle = args->at(0)->codeGen(context);
+        if (handle == nullptr || handle->getType() != llvm::Type::getInt64Ty(context.getGlobalContext())) {
+            Node::printError(location, "File must be Int returned by openWrite");
+            context.addError();
+            return nullptr;
+        }
+        return handle;
+    }
+
+    llvm::Value *FileOutput::writeCodeGen(CodeGenContext &context, llvm::Value *handle) {
+        auto function = context.getModule()->getFunction(
+                operation == Operation::WRITE_LINE ? "__mlang_file_write_line" : "__mlang_file_write");
+
+        std::vector<llvm::Value *> fargs;
+        std::vector<std::pair<Expression *, llvm::Value *>> temporaries;
+        for (size_t i = 1; i < args->size(); i++) {
+            auto arg = args->at(i)->codeGen(context);
+            if (arg == nullptr) {
+                return nullptr;
+            }
+            fargs.push_back(arg);
+            temporaries.emplace_back(args->at(i), arg);
+        }
+
+        if (!FunctionCall::passSlices(context, function, args->at(1), fargs, location)) {
+            context.addError();
+            return nullptr;
+        }
+        if (fargs.at(0)->getType() != llvm::Type::getInt8PtrTy(context.getGlobalContext())) {
+            Node::printError(location, "Format must be String");
+            context.addError();
+            return nullptr;
+        }
+
+        fargs.insert(fargs.begin(), handle);
+        auto call = llvm::CallInst::Create(function, fargs, "", context.currentBlock());
+        for (auto &temporary : temporaries) {
+            dropTemporary(context, temporary.first, temporary.second);
+        }
+        return call;
+    }
+
+    llvm::Value *FileOutput::writeArrayCodeGen(CodeGenContext &context, llvm::Value *handle) {
+        auto stringType = llvm::Type::getInt8PtrTy(context.getGlobalContext());
+        auto intType = llvm::Type::getInt64Ty(context.getGlobalContext());
+        auto doubleType = llvm::Type::getDoubleTy(context.getGlobalContext());
+
+        llvm::Value *array = args->at(1)->codeGen(context);
+        llvm::Value *data = array != nullptr ? context.getArrayPointer(array) : nullptr;
+        if (data == nullptr || (data->getType() != intType->getPointerTo() &&
+                                data->getType() != doubleType->getPointerTo())) {
+            Node::printError(location, "Only IntArray and DoubleArray can be written by writeArray");
+            context.addError();
+            return nullptr;
+        }
+
+        // items are 8 bytes, array is written as it is in memory
+        auto count = context.callSizeOf(array);
+        auto size = llvm::BinaryOperator::Create(llvm::Instruction::Shl, count, llvm::ConstantInt::get(intType, 3),
+                                                 "bytes", context.currentBlock());
+        auto fun = context.getModule()->getOrInsertFunction("__mlang_file_write_array",
+                                                            llvm::Type::getVoidTy(context.getGlobalContext()),
+                                                            intType, stringType, intType);
+        std::vector<llvm::Value *> fargs{handle,
+                                         llvm::CastInst::CreatePointerCast(data, stringType, "cast_tmp",
+                                                                           context.currentBlock()),
+                                         size};
+        auto call = llvm::CallInst::Create(fun, fargs, "", context.currentBlock());
+        dropTemporary(context, args->at(1), array);
+        return call;
+    }
+
+    void FileOutput::dropTemporary(CodeGenContext &context, Expression *expr, llvm::Value *value) {
+        if (context.isArc() && value->getType()->isPointerTy() && !llvm::isa<llvm::Constant>(value) &&
+            expr->getType() != NodeType::IDENTIFIER) {
+            context.createArcCall("__mlang_drop", value);
+        }
+    }
+
+}
@@ -0,0 +1,61 @@
+/**
+ * Created by agent on 18.10.2026.
+ * agent@local
+ *
+ * Author: agent
+ */
+#ifndef MLANG_FILEIO_H
+#define MLANG_FILEIO_H
+
+#include "ast.h"
+
+namespace mlang {
+
+    /**
+     * Buffered file output functions
+     * openWrite(path), write(file, format, ...), writeLine(file, format, ...), writeArray(file, arr), close(file)
+     */
+    class FileOutput : public Expression {
+    public:
+        enum class Operation {
+            OPEN, WRITE, WRITE_LINE, WRITE_ARRAY, CLOSE
+        };
+
+        FileOutput(Operation operation, ExpressionList *args, YYLTYPE location)
+                : operation(operation), args(args), location(std::move(location)) {}
+
+        llvm::Value *codeGen(CodeGenContext &context) override;
+
+        NodeType getType() override { return NodeType::EXPRESSION; }
+
+        std::string toString() override { return "File output"; }
+
+    private:
+        /**
+         * Generate file handle (first argument)
+         */
+        llvm::Value *handleCodeGen(CodeGenContext &context);
+
+        /**
+         * Write formatted text, arguments are same as for print
+         */
+        llvm::Value *writeCodeGen(CodeGenContext &context, llvm::Value *handle);
+
+        /**
+         * Write data of IntArray or DoubleArray (or its slice) in binary form
+         */
+        llvm::Value *writeArrayCodeGen(CodeGenContext &context, llvm::Value *handle);
+
+        /**
+         * Drop temporary arrays and strings passed to runtime (with reference counting)
+         */
+        static void dropTemporary(CodeGenContext &context, Expression *expr, llvm::Value *value);
+
+        Operation operation;
+        ExpressionList *args;
+        YYLTYPE location;
+    };
+
+}
+
+#endif /* MLANG_FILEIO_H */
@@ -6,11 +6,17 @@
  */
 #include "foreach.h"
 #include "codegen.h"
+#include "function.h"
 #include "parser.hpp"
 
 namespace mlang {
 
     llvm::Value *ForEach::codeGen(CodeGenContext &context) {
+        if (expr->getType() == NodeType::FUNCTION_CALL && ((FunctionCall *) expr)->getName() == "stdinLines" &&
+            !context.isUserFunction("stdinLines")) {
+            return linesCodeGen(context);
+        }
+
         llvm::Function *function = context.currentBlock()->getParent();
 
         llvm::BasicBlock *beforeBB = llvm::BasicBlock::Create(context.getGlobalContext(), "before", function);
@@ -20,7 +26,7 @@ namespace mlang {
 
         llvm::Value *array = expr->codeGen(context);
 
-        if (array == nullptr || !array->getType()->isPointerTy()) {
+        if (array == nullptr || (!array->getType()->isPointerTy() && !context.isSliceType(array->getType()))) {
             Node::printError(location, "Invalid value in foreach loop");
             context.addError();
             return nullptr;
@@ -36,10 +42,12 @@ namespace mlang {
             return nullptr;
         }
 
+        llvm::Value *arrayPtr = context.getArrayPointer(array);
+
         llvm::BranchInst::Create(beforeBB, context.currentBlock());
         context.newScope(beforeBB, ScopeType::CODE_BLOCK);
 
-        auto *alloc = new llvm::AllocaInst(array->getType()->getPointerElementType(), 0, ident->getName(),
+        auto *alloc = new llvm::AllocaInst(arrayPtr->getType()->getPointerElementType(), 0, ident->getName(),
                                            context.currentBlock());
         auto variable = Variable::newLocal(alloc);
         context.locals()[ident->getName()] = variable;
@@ -51,9 +59,9 @@ namespace mlang {
         new llvm::StoreInst(from, index->getValue(), false, context.currentBlock());
 
         llvm::Value *indices[1] = {from};
-        llvm::Value *elementPtr = llvm::GetElementPtrInst::Create(nullptr, array, indices, "elem_ptr",
+        llvm::Value *elementPtr = llvm::GetElementPtrInst::Create(nullptr, arrayPtr, indices, "elem_ptr",
                                                                   context.currentBlock());
-        auto item = new llvm::LoadInst(array->getType()->getPointerElementType(), elementPtr, "item", context.currentBlock());
+        auto item = new llvm::LoadInst(arrayPtr->getType()->getPointerElementType(), elementPtr, "item", context.currentBlock());
         new llvm::StoreInst(item, variable->getValue(), false, context.currentBlock());
 
         auto op = llvm::CmpInst::ICMP_SLT;
@@ -79,9 +87,9 @@ namespace mlang {
         new llvm::StoreInst(tmp, index->getValue(), false, context.currentBlock());
 
         llvm::Value *indices2[1] = {tmp};
-        elementPtr = llvm::GetElementPtrInst::Create(nullptr, array, indices2, "elem_ptr",
+        elementPtr = llvm::GetElementPtrInst::Create(nullptr, arrayPtr, indices2, "elem_ptr",
                                                                   context.currentBlock());
-        item = new llvm::LoadInst(array->getType()->getPointerElementType(), elementPtr, "item", context.currentBlock());
+        item = new llvm::LoadInst(arrayPtr->getType()->getPointerElementType(), elementPtr, "item", context.currentBlock());
         new llvm::StoreInst(item, variable->getValue(), false, context.currentBlock());
 
         cmp = llvm::CmpInst::Create(llvm::Instruction::ICmp, op, tmp, to, "cmptmp", context.currentBlock());
@@ -95,4 +103,52 @@ namespace mlang {
         return afterBB;
     }
 
-}
\ No newline at end of file
+    llvm::Value *ForEach::linesCodeGen(CodeGenContext &context) {
+        if (!((FunctionCall *) expr)->getArguments()->empty()) {
+            Node::printError(location, "stdinLines() has no arguments");
+            context.addError();
+            return nullptr;
+        }
+
+        llvm::Function *function = context.currentBlock()->getParent();
+
+        llvm::BasicBlock *beforeBB = llvm::BasicBlock::Create(context.getGlobalContext(), "before", function);
+        llvm::BasicBlock *condBB = llvm::BasicBlock::Create(context.getGlobalContext(), "cond");
+        llvm::BasicBlock *loopBB = llvm::BasicBlock::Create(context.getGlobalContext(), "loop");
+        llvm::BasicBlock *afterBB = llvm::BasicBlock::Create(context.getGlobalContext(), "after");
+
+        llvm::BranchInst::Create(beforeBB, context.currentBlock());
+        context.newScope(beforeBB, ScopeType::CODE_BLOCK);
+
+        auto stringType = llvm::Type::getInt8PtrTy(context.getGlobalContext());
+        auto *alloc = new llvm::AllocaInst(stringType, 0, ident->getName(), context.currentBlock());
+        auto variable = Variable::newLocal(alloc);
+        context.locals()[ident->getName()] = variable;
+        context.setVarType(context.llvmTypeToString(stringType), ident->getName());
+        llvm::BranchInst::Create(condBB, context.currentBlock());
+
+        // next line is null at end of input
+        function->getBasicBlockList().push_back(condBB);
+        auto nextLine = context.getModule()->getOrInsertFunction("__mlang_next_line", stringType);
+        auto line = llvm::CallInst::Create(nextLine, "line", condBB);
+        new llvm::StoreInst(line, variable->getValue(), false, condBB);
+        auto end = new llvm::ICmpInst(*condBB, llvm::CmpInst::ICMP_EQ, line,
+                                      llvm::ConstantPointerNull::get(stringType), "end");
+        llvm::BranchInst::Create(afterBB, loopBB, end, condBB);
+
+        function->getBasicBlockList().push_back(loopBB);
+        context.newScope(loopBB, ScopeType::CODE_BLOCK, afterBB);
+        llvm::Value *loopValue = this->doBlock->codeGen(context);
+        if (loopValue == nullptr || !mlang::CodeGenContext::isBreakingInstruction(loopValue)) {
+            llvm::BranchInst::Create(condBB, context.currentBlock());
+        }
+        context.endScope();
+
+        context.endScope();
+        function->getBasicBlockList().push_back(afterBB);
+        context.setInsertPoint(afterBB);
+
+        return afterBB;
+    }
+
+}
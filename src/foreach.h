@@ -14,6 +14,7 @@ namespace mlang {
     /**
      * Foreach loop node
      * for (id in expr) { block }
+     * for (line in stdinLines()) { block }
      */
     class ForEach : public Statement {
     public:
@@ -32,6 +33,11 @@ namespace mlang {
         std::string toString() override { return "Foreach"; }
 
     private:
+        /**
+         * Loop over lines of stdin - for (line in stdinLines()), every line is read to same String
+         */
+        llvm::Value *linesCodeGen(CodeGenContext &context);
+
         Identifier *ident{nullptr};
         Expression *expr{nullptr};
         Block *doBlock{nullptr};
@@ -0,0 +1,175 @@
+/**
+ * Created by agent on 18.10.2026.
+ * agent@local
+ *
+ * Author: agent
+ */
+#include "format.h"
+#include "codegen.h"
+
+namespace mlang {
+
+    char FormatWriter::conversion(const std::string &format, size_t start, size_t &end) {
+        // only length modifiers are allowed, Int is always 64 bit
+        end = start + 1;
+        while (end < format.size() && (format[end] == 'l' || format[end] == 'h')) {
+            end++;
+        }
+        if (end >= format.size()) {
+            return 0;
+        }
+
+        char conversion = format[end];
+        if (conversion == 'i') {
+            conversion = 'd';
+        }
+        return std::string("dfcs").find(conversion) != std::string::npos ? conversion : 0;
+    }
+
+    bool FormatWriter::isSupported(CodeGenContext &context, const std::string &format,
+                                   std::vector<llvm::Value *> &args) {
+        size_t arg = 1;
+        for (size_t i = 0; i < format.size(); i++) {
+            if (format[i] != '%') {
+                continue;
+            }
+            if (i + 1 < format.size() && format[i + 1] == '%') {
+                i++;
+                continue;
+            }
+
+            size_t end;
+            char c = conversion(format, i, end);
+            if (c == 0 || arg >= args.size() || !isSupported(context, c, args[arg])) {
+                return false;
+            }
+            arg++;
+            i = end;
+        }
+        return arg == args.size();
+    }
+
+    bool FormatWriter::isSupported(CodeGenContext &context, char conversion, llvm::Value *value) {
+        auto type = value->getType();
+        auto stringType = llvm::Type::getInt8PtrTy(context.getGlobalContext());
+        switch (conversion) {
+            case 'd':
+                return type->isIntegerTy();
+            case 'f':
+                return type->isDoubleTy();
+            case 'c':
+                return type->isIntegerTy(8);
+            case 's':
+                return type == stringType || type == context.getSliceType(stringType);
+            default:
+                return false;
+        }
+    }
+
+    llvm::Value *FormatWriter::write(const std::string &format, std::vector<llvm::Value *> &args) {
+        llvm::Value *last = nullptr;
+        std::string text;
+        size_t arg = 1;
+        for (size_t i = 0; i < format.size(); i++) {
+            if (format[i] != '%') {
+                text += format[i];
+                continue;
+            }
+            if (format[i + 1] == '%') {
+                text += '%';
+                i++;
+                continue;
+            }
+
+            if (!text.empty()) {
+                writeLiteral(text);
+                text.clear();
+            }
+            size_t end;
+            last = writeConversion(conversion(format, i, end), args[arg++]);
+            i = end;
+        }
+
+        if (newLine) {
+            text += '\n';
+        }
+        if (!text.empty()) {
+            last = writeLiteral(text);
+        }
+        return last;
+    }
+
+    llvm::Value *FormatWriter::writeValue(llvm::Value *value) {
+        auto type = value->getType();
+        auto stringType = llvm::Type::getInt8PtrTy(context.getGlobalContext());
+        llvm::Value *last;
+        if (type->isIntegerTy(1)) {
+            auto str = llvm::SelectInst::Create(value, context.getStringLiteral("true"),
+                                                context.getStringLiteral("false"), "bool_str", context.currentBlock());
+            last = call("__mlang_write_string", stringType, str);
+        } else if (type->isIntegerTy(64)) {
+            last = writeConversion('d', value);
+        } else if (type->isDoubleTy()) {
+            last = writeConversion('f', value);
+        } else if (type->isIntegerTy(8)) {
+            last = writeConversion('c', value);
+        } else if (context.isSliceType(type) && isSupported(context, 's', value)) {
+            last = writeConversion('s', value);
+        } else {
+            return nullptr;
+        }
+
+        if (newLine) {
+            last = writeLiteral("\n");
+        }
+        return last;
+    }
+
+    llvm::Value *FormatWriter::writeLiteral(const std::string &text) {
+        auto stringType = llvm::Type::getInt8PtrTy(context.getGlobalContext());
+        auto intType = llvm::Type::getInt64Ty(context.getGlobalContext());
+        auto fun = context.getModule()->getOrInsertFunction("__mlang_write", llvm::Type::getVoidTy(context.getGlobalContext()), stringType,
+                                                            intType);
+        std::vector<llvm::Value *> fargs{context.getStringLiteral(text), llvm::ConstantInt::get(intType, text.size())};
+        return llvm::CallInst::Create(fun, fargs, "", context.currentBlock());
+    }
+
+    llvm::Value *FormatWriter::writeConversion(char conversion, llvm::Value *value) {
+        auto &llvmContext = context.getGlobalContext();
+        switch (conversion) {
+            case 'd': {
+                auto intType = llvm::Type::getInt64Ty(llvmContext);
+                // Bool is printed as 0/1 like by printf
+                value = llvm::CastInst::CreateIntegerCast(value, intType, !value->getType()->isIntegerTy(1), "int",
+                                                          context.currentBlock());
+                return call("__mlang_write_int", intType, value);
+            }
+            case 'f':
+                return call("__mlang_write_double", llvm::Type::getDoubleTy(llvmContext), value);
+            case 'c':
+                return call("__mlang_write_char", llvm::Type::getInt8Ty(llvmContext), value);
+            case 's': {
+                auto stringType = llvm::Type::getInt8PtrTy(llvmContext);
+                if (context.isSliceType(value->getType())) {
+                    // slice is not terminated by null, its characters are written up to its length
+                    auto intType = llvm::Type::getInt64Ty(llvmContext);
+                    auto fun = context.getModule()->getOrInsertFunction("__mlang_write", llvm::Type::getVoidTy(context.getGlobalContext()),
+                                                                        stringType, intType);
+                    auto ptr = context.getArrayPointer(value);
+                    std::vector<llvm::Value *> fargs{ptr, context.callLen(value, YYLTYPE())};
+                    return llvm::CallInst::Create(fun, fargs, "", context.currentBlock());
+                }
+                return call("__mlang_write_string", stringType, value);
+            }
+            default:
+                return nullptr;
+        }
+    }
+
+    llvm::Value *FormatWriter::call(const std::string &name, llvm::Type *argType, llvm::Value *value) {
+        auto fun = context.getModule()->getOrInsertFunction(name, llvm::Type::getVoidTy(context.getGlobalContext()), argType);
+        std::vector<llvm::Value *> fargs{value};
+        return llvm::CallInst::Create(fun, fargs, "", context.currentBlock());
+    }
+
+}
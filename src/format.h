@@ -0,0 +1,72 @@
+/**
+ * Created by agent on 18.10.2026.
+ * agent@local
+ *
+ * Author: agent
+ */
+#ifndef MLANG_FORMAT_H
+#define MLANG_FORMAT_H
+
+#include <string>
+#include <vector>
+
+#pragma warning(push, 0)
+
+#include <llvm/IR/Value.h>
+
+#pragma warning(pop)
+
+namespace mlang {
+
+    class CodeGenContext;
+
+    /**
+     * Compile time formatting of print and println
+     * literal format is split to literal parts and typed writes of arguments (%d, %f, %c, %s),
+     * so format is not parsed at runtime and numbers are not converted to String
+     */
+    class FormatWriter {
+    public:
+        FormatWriter(CodeGenContext &context, bool newLine) : context(context), newLine(newLine) {}
+
+        /**
+         * Check if format and arguments can be written by typed writes
+         * format with flags, width, precision or other conversions is left to printf-like runtime
+         */
+        static bool isSupported(CodeGenContext &context, const std::string &format, std::vector<llvm::Value *> &args);
+
+        /**
+         * Write literal format with arguments (first argument is format)
+         * @return last write call
+         */
+        llvm::Value *write(const std::string &format, std::vector<llvm::Value *> &args);
+
+        /**
+         * Write single value without format (println(Int), print(Double), ...)
+         * @return last write call, nullptr if value type cannot be written
+         */
+        llvm::Value *writeValue(llvm::Value *value);
+
+    private:
+        /**
+         * Get conversion at position of '%' in format
+         * @param end set to last character of conversion
+         * @return conversion character, 0 if it is not supported
+         */
+        static char conversion(const std::string &format, size_t start, size_t &end);
+
+        static bool isSupported(CodeGenContext &context, char conversion, llvm::Value *value);
+
+        llvm::Value *writeLiteral(const std::string &text);
+
+        llvm::Value *writeConversion(char conversion, llvm::Value *value);
+
+        llvm::Value *call(const std::string &name, llvm::Type *argType, llvm::Value *value);
+
+        CodeGenContext &context;
+        bool newLine;
+    };
+
+}
+
+#endif /* MLANG_FORMAT_H */
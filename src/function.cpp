@@ -6,6 +6,9 @@
  */
 #include "function.h"
 #include "variable.h"
+#include "timing.h"
+#include "str.h"
+#include "format.h"
 
 namespace mlang {
 
@@ -24,7 +27,7 @@ namespace mlang {
                 context.addError();
                 return nullptr;
             }
-            if (ty->isStructTy()) {
+            if (ty->isStructTy() && !context.isSliceType(ty)) {
                 ty = llvm::PointerType::get(ty, 0);
             }
             argTypes.push_back(ty);
@@ -39,8 +42,9 @@ namespace mlang {
 
         llvm::FunctionType *ftype = llvm::FunctionType::get(t, argTypes, false);
         std::string fname = id->getName();
+        llvm::TimeTraceScope traceScope("Codegen function", fname);
 
-        if (context.isKeyFunction(fname)) {
+        if (context.isReservedFunction(fname)) {
             Node::printError(location, "Invalid function name");
             context.addError();
             return nullptr;
@@ -70,6 +74,7 @@ namespace mlang {
                     valName += "_addr";
                 }
                 actualArgs->setName(valName);
+                context.createArcCall("__mlang_retain", &(*actualArgs));
                 new llvm::StoreInst(&(*actualArgs), allocaInst, context.currentBlock());
             }
             ++actualArgs;
@@ -116,6 +121,84 @@ namespace mlang {
         return fun;
     }
 
+    bool FunctionCall::passSlices(CodeGenContext &context, llvm::Function *function, Expression *formatExpr,
+                                  std::vector<llvm::Value *> &fargs, const YYLTYPE &location) {
+        bool hasSlice = false;
+        for (auto arg : fargs) {
+            hasSlice |= context.isSliceType(arg->getType());
+        }
+        if (!hasSlice) {
+            return true;
+        }
+
+        auto stringSlice = context.getSliceType(llvm::Type::getInt8PtrTy(context.getGlobalContext()));
+        if (!function->isVarArg() || formatExpr->getType() != NodeType::STRING ||
+            context.isSliceType(fargs.at(0)->getType())) {
+            Node::printError(location, "String slice can be printed only with literal format");
+            return false;
+        }
+
+        // slice is not terminated by null, it is printed as %.*s with its size
+        const std::string &format = ((String *) formatExpr)->getValue();
+        std::string sliceFormat;
+        std::vector<llvm::Value *> sliceArgs;
+        size_t arg = 1;
+        for (size_t i = 0; i < format.size(); i++) {
+            sliceFormat += format[i];
+            if (format[i] != '%') {
+                continue;
+            }
+            if (i + 1 < format.size() && format[i + 1] == '%') {
+                sliceFormat += format[++i];
+                continue;
+            }
+
+            size_t spec = i + 1;
+            while (spec < format.size() && std::string("-+ #0123456789.*hlLqjzt").find(format[spec]) != std::string::npos) {
+                if (format[spec] == '*' && arg < fargs.size()) {
+                    sliceArgs.push_back(fargs[arg++]);
+                }
+                spec++;
+            }
+            if (spec >= format.size() || arg >= fargs.size()) {
+                sliceFormat += format.substr(i + 1);
+                break;
+            }
+
+            auto value = fargs[arg++];
+            if (!context.isSliceType(value->getType())) {
+                sliceFormat += format.substr(i + 1, spec - i);
+                sliceArgs.push_back(value);
+            } else if (value->getType() == stringSlice && format[spec] == 's') {
+                size_t precision = format.find('.', i + 1);
+                sliceFormat += format.substr(i + 1, (precision < spec ? precision : spec) - i - 1) + ".*s";
+                auto sliceSize = context.callSizeOf(value);
+                auto size = llvm::CastInst::CreateIntegerCast(sliceSize,
+                                                              llvm::Type::getInt32Ty(context.getGlobalContext()),
+                                                              true, "size", context.currentBlock());
+                sliceArgs.push_back(size);
+                sliceArgs.push_back(context.getArrayPointer(value));
+            } else {
+                Node::printError(location, "Only String slice can be printed and only as %s");
+                return false;
+            }
+            i = spec;
+        }
+
+        for (; arg < fargs.size(); arg++) {
+            if (context.isSliceType(fargs[arg]->getType())) {
+                Node::printError(location, "String slice is not used in format");
+                return false;
+            }
+            sliceArgs.push_back(fargs[arg]);
+        }
+
+        fargs.clear();
+        fargs.push_back(String(sliceFormat).codeGen(context));
+        fargs.insert(fargs.end(), sliceArgs.begin(), sliceArgs.end());
+        return true;
+    }
+
     llvm::Value *FunctionCall::codeGen(CodeGenContext &context) {
         std::string functionName = id->getName();
 
@@ -132,6 +215,7 @@ namespace mlang {
         }
 
         std::vector<llvm::Value *> fargs;
+        std::vector<llvm::Value *> temporaries;
 
         for (auto expr : *args) {
             auto arg = expr->codeGen(context);
@@ -139,6 +223,36 @@ namespace mlang {
                 return nullptr;
             }
             fargs.push_back(arg);
+            if (context.isArc() && arg->getType()->isPointerTy() && !llvm::isa<llvm::Constant>(arg) &&
+                expr->getType() != NodeType::IDENTIFIER) {
+                temporaries.push_back(arg);
+            }
+        }
+
+        // print and println with literal format or single value are formatted at compile time
+        if ((functionName == "print" || functionName == "println") && !fargs.empty()) {
+            FormatWriter writer(context, functionName == "println");
+            llvm::Value *written = nullptr;
+            if (args->at(0)->getType() == NodeType::STRING) {
+                const std::string &format = ((String *) args->at(0))->getValue();
+                if (FormatWriter::isSupported(context, format, fargs)) {
+                    written = writer.write(format, fargs);
+                }
+            } else if (fargs.size() == 1 && !fargs.at(0)->getType()->isPointerTy()) {
+                written = writer.writeValue(fargs.at(0));
+            }
+
+            if (written != nullptr) {
+                for (auto temporary : temporaries) {
+                    context.createArcCall("__mlang_drop", temporary);
+                }
+                return written;
+            }
+        }
+
+        if (!passSlices(context, function, args->empty() ? nullptr : args->front(), fargs, location)) {
+            context.addError();
+            return nullptr;
         }
 
         auto fType = function->getFunctionType();
@@ -157,7 +271,22 @@ namespace mlang {
             }
         }
 
-        return llvm::CallInst::Create(function, fargs, "", context.currentBlock());
+        // temporary array or string is held by caller during call, so it can be borrowed by called function
+        for (auto temporary : temporaries) {
+            context.createArcCall("__mlang_retain", temporary);
+        }
+
+        auto call = llvm::CallInst::Create(function, fargs, "", context.currentBlock());
+
+        if (!temporaries.empty()) {
+            // returned value can be one of temporaries
+            context.createArcCall("__mlang_retain", call);
+            for (auto temporary : temporaries) {
+                context.createArcCall("__mlang_release", temporary);
+            }
+            context.createArcCall("__mlang_unretain", call);
+        }
+        return call;
     }
 
 }
@@ -75,10 +75,22 @@ namespace mlang {
 
         llvm::Value *codeGen(CodeGenContext &context) override;
 
-        NodeType getType() override { return NodeType::EXPRESSION; }
+        NodeType getType() override { return NodeType::FUNCTION_CALL; }
 
         std::string toString() override { return "Function call"; }
 
+        std::string getName() const { return id->getName(); }
+
+        ExpressionList *getArguments() const { return args; }
+
+        /**
+         * Pass String slices to print functions, %s of slice in literal format is changed to %.*s with slice size
+         * @param formatExpr format expression, its value is first of fargs
+         * @return false if slice cannot be passed
+         */
+        static bool passSlices(CodeGenContext &context, llvm::Function *function, Expression *formatExpr,
+                               std::vector<llvm::Value *> &fargs, const YYLTYPE &location);
+
     private:
         Identifier *id{nullptr};
         ExpressionList *args{nullptr};
@@ -0,0 +1,155 @@
+/**
+ * Created by agent on 18.10.2026.
+ * agent@local
+ *
+ * Author: agent
+ */
+#include "jitcache.h"
+
+#pragma warning(push, 0)
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MD5.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
+
+#pragma warning(pop)
+
+#ifndef MLANG_VERSION
+#define MLANG_VERSION "dev"
+#endif
+
+namespace mlang {
+
+    /**
+     * Write file to temporary path and rename it,
+     * so concurrently running programs never see half written file
+     */
+    static void writeFile(const std::string &path, llvm::StringRef content) {
+        int fd;
+        llvm::SmallString<128> tmpPath;
+        if (llvm::sys::fs::createUniqueFile(path + "-%%%%%%.tmp", fd, tmpPath)) {
+            return;
+        }
+
+        {
+            llvm::raw_fd_ostream out(fd, true);
+            out << content;
+        }
+
+        if (llvm::sys::fs::rename(tmpPath, path)) {
+            llvm::sys::fs::remove(tmpPath);
+        }
+    }
+
+    bool JITCache::load() {
+        auto buffer = llvm::MemoryBuffer::getFile(importsPath());
+        if (!buffer) {
+            return false;
+        }
+
+        llvm::SmallVector<llvm::StringRef, 8> lines;
+        (*buffer)->getBuffer().split(lines, '\n', -1, false);
+        if (lines.empty()) {
+            return false;
+        }
+
+        entry = lines[0].str();
+        std::vector<std::string> imports;
+        for (size_t i = 1; i < lines.size(); i++) {
+            imports.push_back(lines[i].str());
+        }
+
+        key = computeKey(imports);
+        return !key.empty() && llvm::sys::fs::exists(objectPath());
+    }
+
+    void JITCache::update(const std::string &entryName, const std::vector<std::string> &imports) {
+        entry = entryName;
+        key = computeKey(imports);
+        if (key.empty() || llvm::sys::fs::create_directories(dir)) {
+            key.clear();
+            return;
+        }
+
+        std::string content = entry + "\n";
+        for (auto &import : imports) {
+            content += import + "\n";
+        }
+        writeFile(importsPath(), content);
+    }
+
+    std::unique_ptr<llvm::MemoryBuffer> JITCache::getCachedObject() {
+        if (key.empty()) {
+            return nullptr;
+        }
+
+        auto buffer = llvm::MemoryBuffer::getFile(objectPath());
+        if (!buffer) {
+            return nullptr;
+        }
+        return std::move(*buffer);
+    }
+
+    void JITCache::notifyObjectCompiled(const llvm::Module *module, llvm::MemoryBufferRef object) {
+        if (!key.empty()) {
+            writeFile(objectPath(), object.getBuffer());
+        }
+    }
+
+    std::unique_ptr<llvm::MemoryBuffer> JITCache::getObject(const llvm::Module *module) {
+        return getCachedObject();
+    }
+
+    std::string JITCache::computeKey(const std::vector<std::string> &imports) const {
+        llvm::MD5 hash;
+        hash.update(MLANG_VERSION);
+        hash.update(LLVM_VERSION_STRING);
+        hash.update(std::to_string(optLevel));
+        hash.update(cpu);
+
+        // object calls build-in functions, so it is rebuilt with runtime (missing runtime is hashed as empty)
+        if (auto buffer = llvm::MemoryBuffer::getFile(runtime)) {
+            hash.update((*buffer)->getBuffer());
+        }
+
+        std::vector<std::string> files{source};
+        files.insert(files.end(), imports.begin(), imports.end());
+        for (auto &file : files) {
+            auto buffer = llvm::MemoryBuffer::getFile(file);
+            if (!buffer) {
+                return std::string();
+            }
+            hash.update(file);
+            hash.update(std::to_string((*buffer)->getBufferSize()));
+            hash.update((*buffer)->getBuffer());
+        }
+
+        llvm::MD5::MD5Result result;
+        hash.final(result);
+        return result.digest().str().str();
+    }
+
+    std::string JITCache::importsPath() const {
+        llvm::SmallString<128> absolute(source);
+        llvm::sys::fs::make_absolute(absolute);
+
+        llvm::MD5 hash;
+        hash.update(absolute.str());
+        llvm::MD5::MD5Result result;
+        hash.final(result);
+
+        llvm::SmallString<128> path(dir);
+        llvm::sys::path::append(path, result.digest().str() + ".imports");
+        return path.str().str();
+    }
+
+    std::string JITCache::objectPath() const {
+        llvm::SmallString<128> path(dir);
+        llvm::sys::path::append(path, key + ".o");
+        return path.str().str();
+    }
+
+}
@@ -0,0 +1,82 @@
+/**
+ * Created by agent on 18.10.2026.
+ * agent@local
+ *
+ * Author: agent
+ */
+#ifndef MLANG_JITCACHE_H
+#define MLANG_JITCACHE_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#pragma warning(push, 0)
+
+#include <llvm/ExecutionEngine/ObjectCache.h>
+#include <llvm/Support/MemoryBuffer.h>
+
+#pragma warning(pop)
+
+namespace mlang {
+
+    /**
+     * Persistent on-disk cache of JIT compiled objects
+     * key is hash of source file, all imported files, build-in runtime, compiler version, optimization level and target cpu
+     */
+    class JITCache : public llvm::ObjectCache {
+    public:
+        JITCache(std::string dir, std::string source, std::string runtime, int optLevel, std::string cpu)
+                : dir(std::move(dir)), source(std::move(source)), runtime(std::move(runtime)), optLevel(optLevel),
+                  cpu(std::move(cpu)) {}
+
+        ~JITCache() override = default;
+
+        /**
+         * Load imports saved by previous run of source
+         * @return true if object for current sources is cached
+         */
+        bool load();
+
+        /**
+         * Compute key from source and imported files and save them for next run
+         */
+        void update(const std::string &entryName, const std::vector<std::string> &imports);
+
+        /**
+         * Get name of entry function of cached object
+         */
+        const std::string &getEntryName() const { return entry; }
+
+        /**
+         * Get cached object for current key
+         */
+        std::unique_ptr<llvm::MemoryBuffer> getCachedObject();
+
+        void notifyObjectCompiled(const llvm::Module *module, llvm::MemoryBufferRef object) override;
+
+        std::unique_ptr<llvm::MemoryBuffer> getObject(const llvm::Module *module) override;
+
+    private:
+        /**
+         * Hash files content with compiler version, opt level and target cpu
+         * @return empty string if some file cannot be read
+         */
+        std::string computeKey(const std::vector<std::string> &imports) const;
+
+        std::string importsPath() const;
+
+        std::string objectPath() const;
+
+        std::string dir;
+        std::string source;
+        std::string runtime;
+        int optLevel{0};
+        std::string cpu;
+        std::string key;
+        std::string entry;
+    };
+
+}
+
+#endif /* MLANG_JITCACHE_H */
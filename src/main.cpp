@@ -6,6 +6,7 @@
  */
 
 #include <cstdio>
+#include <cstdlib>
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -13,6 +14,8 @@
 #include <stack>
 #include "ast.h"
 #include "codegen.h"
+#include "jitcache.h"
+#include "timing.h"
 #include <Windows.h>
 
 extern int yyparse();
@@ -22,6 +25,7 @@ extern int yylex_destroy();
 extern FILE *yyin;
 extern mlang::Block *programBlock;
 extern std::stack<std::string> fileNames;
+extern std::vector<std::string> importedFiles;
 extern int parsing_error;
 
 void help();
@@ -29,8 +33,25 @@ void help();
 std::string getExecutablePath();
 
 int main(int argc, char **argv) {
+    // declared first, so it finishes after everything else is destroyed
+    mlang::TimingScope timing;
     bool debug = false;
     bool run = false;
+    auto optLevel = mlang::OptLevel::O3;
+    unsigned threads = 1;
+    bool profileGenerate = false;
+    std::string profileFile;
+    std::string profileUse;
+    std::string cpu;
+    bool heapProfile = false;
+    bool arc = false;
+    int64_t hugeThreshold = -1;
+    auto flushMode = FlushMode::AUTO;
+    int64_t flushSize = 0;
+    bool emitLlvm = false;
+    bool emitBc = false;
+    bool useCache = false;
+    std::string cacheDir = ".mlang-cache";
     bool hasSrc = false;
     std::string source;
 
@@ -41,8 +62,66 @@ int main(int argc, char **argv) {
             help();
         } else if (arg == "-d" || arg == "--debug") {
             debug = true;
+            optLevel = mlang::OptLevel::O0;
+        } else if (arg == "-O0") {
+            optLevel = mlang::OptLevel::O0;
+        } else if (arg == "-O1") {
+            optLevel = mlang::OptLevel::O1;
+        } else if (arg == "-O2") {
+            optLevel = mlang::OptLevel::O2;
+        } else if (arg == "-O3") {
+            optLevel = mlang::OptLevel::O3;
+        } else if (arg == "-Os") {
+            optLevel = mlang::OptLevel::Os;
         } else if (arg == "-r" || arg == "--run") {
             run = true;
+        } else if (arg.rfind("-j", 0) == 0) {
+            std::string count = arg.size() > 2 ? arg.substr(2) : (i + 1 < argc ? argv[++i] : "");
+            threads = (unsigned) std::max(1, std::atoi(count.c_str()));
+        } else if (arg == "--profile-generate") {
+            profileGenerate = true;
+        } else if (arg.rfind("--profile-generate=", 0) == 0) {
+            profileGenerate = true;
+            profileFile = arg.substr(19);
+        } else if (arg.rfind("--profile-use=", 0) == 0) {
+            profileUse = arg.substr(14);
+        } else if (arg.rfind("--mcpu=", 0) == 0) {
+            cpu = arg.substr(7);
+        } else if (arg == "--heap-profile") {
+            heapProfile = true;
+        } else if (arg.rfind("--huge-threshold=", 0) == 0) {
+            hugeThreshold = std::max(0LL, std::atoll(arg.substr(17).c_str()));
+        } else if (arg.rfind("--flush=", 0) == 0) {
+            std::string mode = arg.substr(8);
+            if (mode == "line") {
+                flushMode = FlushMode::LINE;
+            } else if (mode == "full") {
+                flushMode = FlushMode::FULL;
+            } else {
+                char *end = nullptr;
+                flushSize = std::strtoll(mode.c_str(), &end, 10);
+                if (mode.empty() || *end != '\0' || flushSize <= 0) {
+                    std::cerr << "Invalid --flush value '" << mode << "', expected line, full or size in bytes."
+                              << std::endl;
+                    return 1;
+                }
+                flushMode = FlushMode::SIZE;
+            }
+        } else if (arg == "--arc") {
+            arc = true;
+        } else if (arg == "--emit-llvm") {
+            emitLlvm = true;
+        } else if (arg == "--emit-bc") {
+            emitBc = true;
+        } else if (arg == "--time-report") {
+            mlang::Timing::enableTimeReport();
+        } else if (arg.rfind("--trace=", 0) == 0) {
+            mlang::Timing::enableTrace(arg.substr(8));
+        } else if (arg == "--cache") {
+            useCache = true;
+        } else if (arg.rfind("--cache-dir=", 0) == 0) {
+            useCache = true;
+            cacheDir = arg.substr(12);
         } else {
             if (!hasSrc) {
                 source = arg;
@@ -60,6 +139,36 @@ int main(int argc, char **argv) {
     }
 
     std::string fileName = source;
+
+    if (profileGenerate && run) {
+        std::cerr << "Profile generation is supported only for compiled executable (without -r)." << std::endl;
+        return 1;
+    }
+    if (profileGenerate && optLevel == mlang::OptLevel::O0) {
+        std::cerr << "Profile generation requires optimization level -O1 or higher." << std::endl;
+        return 1;
+    }
+    if (profileGenerate && profileFile.empty()) {
+        profileFile = source + ".profraw";
+    }
+
+    auto buildinsPath = getExecutablePath() + "\\..\\buildins.bc";
+    std::unique_ptr<mlang::JITCache> cache;
+    // cached code does not depend on profiling, memory management and output options
+    if (run && useCache && profileUse.empty() && !heapProfile && !arc && hugeThreshold < 0 &&
+        flushMode == FlushMode::AUTO) {
+        cache = std::make_unique<mlang::JITCache>(cacheDir, fileName, buildinsPath, (int) optLevel,
+                                                  cpu.empty() ? llvm::sys::getHostCPUName().str() : cpu);
+        if (cache->load()) {
+            {
+                mlang::CodeGenContext context(std::cout, debug, run, optLevel);
+                context.setTargetCPU(cpu);
+                context.runCachedCode(cache->getCachedObject(), cache->getEntryName());
+            }
+            return 0;
+        }
+    }
+
     yyin = fopen(fileName.c_str(), "r+");
 
     if (yyin == nullptr) {
@@ -69,7 +178,12 @@ int main(int argc, char **argv) {
 
     fileNames.push("");
     fileNames.push(fileName);
-    if (yyparse() || parsing_error) {
+    int parseResult;
+    {
+        mlang::PhaseScope phase("Parse");
+        parseResult = yyparse();
+    }
+    if (parseResult || parsing_error) {
         yylex_destroy();
         return 1;
     }
@@ -78,29 +192,74 @@ int main(int argc, char **argv) {
         std::cerr << "Parsing " << fileName << "failed. Abort" << std::endl;
     } else {
         std::ostringstream devNull;
-        mlang::CodeGenContext context(std::cout, debug, run);
+        mlang::CodeGenContext context(std::cout, debug, run, optLevel);
+        context.setRuntimePath(buildinsPath);
+        context.setCompileThreads(threads > 1 ? threads : 0);
+        context.setTargetCPU(cpu);
+        if (profileGenerate) {
+            context.setProfileGenerate(profileFile);
+        }
+        context.setProfileUse(profileUse);
+        if (heapProfile) {
+            context.setHeapProfile(source + ".heap.folded");
+        }
+        context.setArc(arc);
+        context.setHugeThreshold(hugeThreshold);
+        context.setFlushMode(flushMode, flushSize);
 
         if (context.generateCode(*programBlock)) {
             if (run) {
+                if (cache != nullptr) {
+                    cache->update(context.getEntryFunctionName(), importedFiles);
+                    context.setObjectCache(cache.get());
+                }
                 context.runCode();
             } else {
-                std::string irFileName = fileName + ".ir";
-                std::ofstream out(irFileName);
-                context.saveCode(out);
-                out.close();
-                std::cout << "File with llvm ir (" + fileName + ") generated." << std::endl;
-
                 auto index = fileName.find(".mlang", 0);
                 if (index != std::string::npos) {
                     fileName.replace(index, 6, "");
                 }
 
-                auto buildinsPath = getExecutablePath() + "\\..\\buildins.bc";
+                if (emitLlvm) {
+                    std::string irFileName = source + ".ir";
+                    if (context.saveCode(irFileName)) {
+                        std::cout << "File with llvm ir (" + irFileName + ") generated." << std::endl;
+                    }
+                }
+
+                if (emitBc) {
+                    std::string bcFileName = source + ".bc";
+                    if (context.saveBitcode(bcFileName)) {
+                        std::cout << "File with llvm bitcode (" + bcFileName + ") generated." << std::endl;
+                    }
+                }
+
+                std::vector<std::string> objFiles;
+                if (context.emitObjects(fileName, threads, objFiles)) {
+                    std::string objFileNames;
+                    for (auto &objFileName : objFiles) {
+                        std::cout << "Object file " + objFileName + " generated." << std::endl;
+                        objFileNames += objFileName + " ";
+                    }
+
+                    // build-in functions are already in object file if runtime was linked
+                    std::string runtime = context.isRuntimeLinked() ? "" : " " + buildinsPath;
+                    // profile runtime writes counters on exit
+                    if (profileGenerate) {
+                        runtime += " -fprofile-generate";
+                    }
 
-                int res = system(("clang -x ir -o " + fileName + ".exe " + irFileName + " " + buildinsPath +
-                                  " -Wno-everything").c_str());
-                if (!res) {
-                    std::cout << "Executable " + fileName + ".exe generated." << std::endl;
+                    mlang::PhaseScope phase("Link executable");
+                    int res = system(("clang -o " + fileName + ".exe " + objFileNames + runtime +
+                                      " -Wno-everything").c_str());
+                    if (!res) {
+                        std::cout << "Executable " + fileName + ".exe generated." << std::endl;
+                        if (profileGenerate) {
+                            std::cout << "Run it to write profile " + profileFile + ", then use "
+                                         "'llvm-profdata merge -o " + fileName + ".profdata " + profileFile +
+                                         "' and --profile-use=" + fileName + ".profdata" << std::endl;
+                        }
+                    }
                 }
             }
         }
@@ -129,8 +288,22 @@ std::string getExecutablePath() {
 
 void help() {
     std::cout << "Usage:\n";
-    std::cout << "mlang filename -h -d -r \n";
+    std::cout << "mlang filename -h -d -O<n> -r \n";
     std::cout << "\t-h prints this help text.\n";
-    std::cout << "\t-d debug code generation. Disables the code optimizer pass.\n";
-    std::cout << "\t-r run program (just in time compilation), otherwise LLVM-IR and executable is generated\n";
+    std::cout << "\t-d debug code generation. Disables the code optimizer pass (same as -O0).\n";
+    std::cout << "\t-O0, -O1, -O2, -O3, -Os optimization level (default -O3).\n";
+    std::cout << "\t-r run program (lazy just in time compilation), otherwise native object file and executable is generated\n";
+    std::cout << "\t-j <n> compile in n parallel threads (module is split to n partitions, JIT compiles functions concurrently)\n";
+    std::cout << "\t--profile-generate[=<file>] instrument executable, profile is written to file on exit (default filename.profraw)\n";
+    std::cout << "\t--profile-use=<file> optimize using profile (.profdata) from instrumented run\n";
+    std::cout << "\t--mcpu=<cpu> generate code for cpu (e.g. generic, skylake), default is host cpu with all its features\n";
+    std::cout << "\t--heap-profile report allocations per source line when program ends (also filename.heap.folded for flamegraph)\n";
+    std::cout << "\t--huge-threshold=<bytes> arrays of at least this size are mapped from os aligned to 2 MB huge pages (default 4 MB)\n";
+    std::cout << "\t--flush=line|full|<bytes> flush output of print after each line, when buffer is full or after bytes (default line for terminal, otherwise full)\n";
+    std::cout << "\t--arc free arrays and strings automatically by reference counting (rm frees only unreferenced memory)\n";
+    std::cout << "\t--emit-llvm save LLVM-IR of program (filename.ir) next to generated executable\n";
+    std::cout << "\t--emit-bc save LLVM bitcode of program (filename.bc) next to generated executable\n";
+    std::cout << "\t--time-report print wall and cpu time of each compiler phase\n";
+    std::cout << "\t--trace=<file> write chrome trace (json) of compiler phases, functions and passes\n";
+    std::cout << "\t--cache, --cache-dir=<dir> cache compiled program on disk (with -r), default dir is .mlang-cache\n";
 }
\ No newline at end of file
@@ -159,6 +159,7 @@ primary_expr : ident { $<ident>$ = $1; }
 
 postfix_expr : primary_expr
              | postfix_expr '[' expr ']' { $$ = new mlang::ArrayAccess($1, $3, @$); }
+             | postfix_expr '[' range ']' { $$ = new mlang::ArraySlice($1, $3, @$); }
              | postfix_expr TINC { $$ = new mlang::UnaryOp($2, $1, 0, @$); }
              | postfix_expr TDEC { $$ = new mlang::UnaryOp($2, $1, 0, @$); }
              ;
@@ -26,6 +26,8 @@ namespace mlang {
 
         std::string toString() override { return "String literal"; }
 
+        const std::string &getValue() const { return value; }
+
     private:
         std::string value;
     };
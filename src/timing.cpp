@@ -0,0 +1,67 @@
+/**
+ * Created by agent on 18.10.2026.
+ * agent@local
+ *
+ * Author: agent
+ */
+#include "timing.h"
+
+#include <map>
+#include <memory>
+
+#pragma warning(push, 0)
+
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/raw_ostream.h>
+
+#pragma warning(pop)
+
+namespace mlang {
+
+    static std::unique_ptr<llvm::TimerGroup> timerGroup;
+    static std::map<std::string, std::unique_ptr<llvm::Timer>> timers;
+    static std::string traceFileName;
+
+    void Timing::enableTimeReport() {
+        if (timerGroup == nullptr) {
+            timerGroup = std::make_unique<llvm::TimerGroup>("mlang", "Compiler phases");
+        }
+    }
+
+    void Timing::enableTrace(const std::string &fileName) {
+        traceFileName = fileName;
+        llvm::timeTraceProfilerInitialize(0, "mlang");
+    }
+
+    llvm::Timer *Timing::getTimer(const std::string &phase) {
+        if (timerGroup == nullptr) {
+            return nullptr;
+        }
+
+        auto &timer = timers[phase];
+        if (timer == nullptr) {
+            timer = std::make_unique<llvm::Timer>(phase, phase, *timerGroup);
+        }
+        return timer.get();
+    }
+
+    void Timing::finish() {
+        if (timerGroup != nullptr) {
+            timerGroup->print(llvm::errs());
+            timers.clear();
+            timerGroup.reset();
+        }
+
+        if (isTraceEnabled()) {
+            std::error_code errorCode;
+            llvm::raw_fd_ostream out(traceFileName, errorCode, llvm::sys::fs::OF_Text);
+            if (errorCode) {
+                llvm::errs() << "Could not write trace file " << traceFileName << ": " << errorCode.message() << "\n";
+            } else {
+                llvm::timeTraceProfilerWrite(out);
+            }
+            llvm::timeTraceProfilerCleanup();
+        }
+    }
+
+}
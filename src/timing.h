@@ -0,0 +1,80 @@
+/**
+ * Created by agent on 18.10.2026.
+ * agent@local
+ *
+ * Author: agent
+ */
+#ifndef MLANG_TIMING_H
+#define MLANG_TIMING_H
+
+#include <string>
+
+#pragma warning(push, 0)
+
+#include <llvm/Support/Timer.h>
+#include <llvm/Support/TimeProfiler.h>
+
+#pragma warning(pop)
+
+namespace mlang {
+
+    /**
+     * Compiler phase timing (--time-report) and chrome trace output (--trace=file)
+     */
+    class Timing {
+    public:
+        /**
+         * Collect wall and cpu time of each compiler phase
+         */
+        static void enableTimeReport();
+
+        /**
+         * Collect trace events, they are written to file in finish()
+         */
+        static void enableTrace(const std::string &fileName);
+
+        static bool isTraceEnabled() { return llvm::timeTraceProfilerEnabled(); }
+
+        /**
+         * Get timer of phase, nullptr if time report is disabled
+         */
+        static llvm::Timer *getTimer(const std::string &phase);
+
+        /**
+         * Print time report and write trace file (only first call writes them)
+         */
+        static void finish();
+    };
+
+    /**
+     * Call Timing::finish when compiler leaves its scope, so report and trace are written on every exit path
+     */
+    class TimingScope {
+    public:
+        TimingScope() = default;
+
+        TimingScope(const TimingScope &) = delete;
+
+        TimingScope &operator=(const TimingScope &) = delete;
+
+        ~TimingScope() { Timing::finish(); }
+    };
+
+    /**
+     * Measure compiler phase in current scope
+     */
+    class PhaseScope {
+    public:
+        explicit PhaseScope(const std::string &phase) : timeRegion(Timing::getTimer(phase)), traceScope(phase) {}
+
+        PhaseScope(const std::string &phase, const std::string &detail) : timeRegion(Timing::getTimer(phase)),
+                                                                          traceScope(phase, detail) {}
+
+    private:
+        llvm::TimeRegion timeRegion;
+        llvm::TimeTraceScope traceScope;
+    };
+
+}
+
+#endif /* MLANG_TIMING_H */
@@ -28,7 +28,7 @@ namespace mlang {
         Variable *variable;
         bool global = context.getScopeType() == ScopeType::GLOBAL_BLOCK;
 
-        if (ty->isStructTy()) {
+        if (ty->isStructTy() && !context.isSliceType(ty)) {
             bool constant = ty->getStructName() == "val";
             if (global) {
                 variable = Variable::newGlobal(nullptr, constant);
@@ -40,6 +40,8 @@ namespace mlang {
                 auto *gv = new llvm::GlobalVariable(*context.getModule(), ty, true, llvm::GlobalValue::PrivateLinkage,
                                                     llvm::Constant::getNullValue(ty), id->getName());
                 variable = Variable::newGlobal(gv);
+            } else if (context.isArc() && ty->isPointerTy()) {
+                variable = Variable::newLocal(context.createArcVariable(ty, id->getName()));
             } else {
                 auto *alloc = new llvm::AllocaInst(ty, 0, id->getName(), context.currentBlock());
                 variable = Variable::newLocal(alloc);